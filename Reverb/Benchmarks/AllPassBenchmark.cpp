@@ -0,0 +1,204 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "AllPassChain.h"
+#include "PowerOfTwoDelayLine.h"
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// The all-pass in the form it had before it went canonical, a dry and a
+// wet delay line per channel, against single canonical all-passes run in
+// series and AllPassChain in both topologies. Every form runs whole delays
+// on stereo noise, and the memory is what each takes from its arena
+namespace benchmark {
+namespace {
+constexpr std::array<float, AllPassChain::maxNumStages> delayTimes {
+  5.1f, 7.7f, 3.6f, 11.3f, 4.3f, 9.1f, 2.9f, 6.7f
+};  // in ms
+constexpr float feedback = 0.6f;
+constexpr int stereoSpread = 23;  // in samples
+
+// A stage's delay in whole samples, with the spread added to the right
+// channel, and the ring it needs
+int getDelay(float delayTime, int channel) {
+  return static_cast<int>(std::round(delayTime / 1000.0f * sampleRate)) +
+         (channel > 0 ? stereoSpread : 0);
+}
+
+int getRequiredSize(float delayTime, int channel) {
+  return PowerOfTwoDelayLine::getRequiredSize(
+      static_cast<float>(getDelay(delayTime, channel) + 1));
+}
+
+// y[n] = -g * x[n] + x[n - D] + g * y[n - D], with x and y each kept in a
+// delay line of their own
+class TwoBufferAllPass {
+public:
+  static size_t getMemorySize(float delayTime) {
+    size_t memorySize = 0;
+
+    for (int channel = 0; channel < 2; ++channel) {
+      memorySize += 2 * AlignedArena::getAllocationSize<float>(
+          static_cast<size_t>(getRequiredSize(delayTime, channel)));
+    }
+
+    return memorySize;
+  }
+
+  void prepare(float delayTime, AlignedArena& arena) {
+    for (size_t channel = 0; channel < 2; ++channel) {
+      auto size = getRequiredSize(delayTime, static_cast<int>(channel));
+      dry[channel].setMemory(arena.allocate<float>(static_cast<size_t>(size)), size);
+      wet[channel].setMemory(arena.allocate<float>(static_cast<size_t>(size)), size);
+      delays[channel] = getDelay(delayTime, static_cast<int>(channel));
+    }
+  }
+
+  void process(juce::AudioBuffer<float>& buffer) noexcept {
+    for (size_t channel = 0; channel < 2; ++channel) {
+      auto* samples = buffer.getWritePointer(static_cast<int>(channel));
+      auto& dryLine = dry[channel];
+      auto& wetLine = wet[channel];
+      auto delay = delays[channel];
+
+      for (int i = 0; i < buffer.getNumSamples(); ++i) {
+        auto x = samples[i];
+        dryLine.push(x);
+        auto y = -feedback * x + dryLine.get(delay) + feedback * wetLine.get(delay);
+        wetLine.push(y);
+        samples[i] = y;
+      }
+    }
+  }
+
+private:
+  std::array<PowerOfTwoDelayLine, 2> dry, wet;
+  std::array<int, 2> delays {};
+};
+
+// v[n] = x[n] + g * v[n - D], y[n] = v[n - D] - g * v[n], with only v kept,
+// in one delay line per channel. Both channels run in one loop
+class CanonicalAllPass {
+public:
+  static size_t getMemorySize(float delayTime) {
+    size_t memorySize = 0;
+
+    for (int channel = 0; channel < 2; ++channel) {
+      memorySize += AlignedArena::getAllocationSize<float>(
+          static_cast<size_t>(getRequiredSize(delayTime, channel)));
+    }
+
+    return memorySize;
+  }
+
+  void prepare(float delayTime, AlignedArena& arena) {
+    for (size_t channel = 0; channel < 2; ++channel) {
+      auto size = getRequiredSize(delayTime, static_cast<int>(channel));
+      states[channel].setMemory(arena.allocate<float>(static_cast<size_t>(size)), size);
+      delays[channel] = getDelay(delayTime, static_cast<int>(channel));
+    }
+  }
+
+  void process(juce::AudioBuffer<float>& buffer) noexcept {
+    auto* left = buffer.getWritePointer(0);
+    auto* right = buffer.getWritePointer(1);
+
+    for (int i = 0; i < buffer.getNumSamples(); ++i) {
+      left[i] = filterSample(0, left[i]);
+      right[i] = filterSample(1, right[i]);
+    }
+  }
+
+private:
+  float filterSample(size_t channel, float x) noexcept {
+    // v[n - D] is read before v[n] is pushed, so it is D - 1 behind
+    auto delayed = states[channel].get(delays[channel] - 1);
+    auto state = x + feedback * delayed;
+    states[channel].push(state);
+    return delayed - feedback * state;
+  }
+
+  std::array<PowerOfTwoDelayLine, 2> states;
+  std::array<int, 2> delays {};
+};
+
+void setUpChain(AllPassChain& chain, int numStages, AllPassChain::Topology topology) {
+  chain.setNumStages(numStages);
+  chain.setSampleRate(sampleRate);
+  chain.setTopology(topology);
+  chain.setStereoSpread(stereoSpread);
+
+  for (int stage = 0; stage < numStages; ++stage) {
+    chain.setDelayTime(stage, delayTimes[static_cast<size_t>(stage)]);
+    chain.setFeedback(stage, feedback);
+  }
+}
+}
+
+void runAllPass() {
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::printf("ns per stereo frame / bytes of delay memory, %d sample blocks\n", blockSize);
+  std::printf("%-7s %18s %18s %18s %18s\n", "stages", "two-buffer", "canonical",
+              "chain", "nested chain");
+
+  for (int numStages : { 2, 4, 8 }) {
+    std::vector<TwoBufferAllPass> twoBuffer(static_cast<size_t>(numStages));
+    std::vector<CanonicalAllPass> canonical(static_cast<size_t>(numStages));
+    AllPassChain series, nested;
+
+    size_t twoBufferSize = 0, canonicalSize = 0;
+
+    for (int stage = 0; stage < numStages; ++stage) {
+      twoBufferSize += TwoBufferAllPass::getMemorySize(delayTimes[static_cast<size_t>(stage)]);
+      canonicalSize += CanonicalAllPass::getMemorySize(delayTimes[static_cast<size_t>(stage)]);
+    }
+
+    setUpChain(series, numStages, AllPassChain::Topology::series);
+    setUpChain(nested, numStages, AllPassChain::Topology::nested);
+    auto seriesSize = series.getMemorySize(2);
+    auto nestedSize = nested.getMemorySize(2);
+
+    AlignedArena twoBufferArena, canonicalArena, seriesArena, nestedArena;
+    twoBufferArena.reset(twoBufferSize);
+    canonicalArena.reset(canonicalSize);
+    seriesArena.reset(seriesSize);
+    nestedArena.reset(nestedSize);
+
+    for (int stage = 0; stage < numStages; ++stage) {
+      twoBuffer[static_cast<size_t>(stage)].prepare(delayTimes[static_cast<size_t>(stage)],
+                                                    twoBufferArena);
+      canonical[static_cast<size_t>(stage)].prepare(delayTimes[static_cast<size_t>(stage)],
+                                                    canonicalArena);
+    }
+
+    series.prepare(sampleRate, 2, seriesArena);
+    nested.prepare(sampleRate, 2, nestedArena);
+
+    std::array<juce::AudioBuffer<float>, 4> buffers;
+
+    for (auto& buffer : buffers)
+      buffer.setSize(2, blockSize);
+
+    auto times = compare({ [&] {
+                             copy(input, buffers[0]);
+                             for (auto& filter : twoBuffer)
+                               filter.process(buffers[0]);
+                           },
+                           [&] {
+                             copy(input, buffers[1]);
+                             for (auto& filter : canonical)
+                               filter.process(buffers[1]);
+                           },
+                           [&] { copy(input, buffers[2]); series.process(buffers[2]); },
+                           [&] { copy(input, buffers[3]); nested.process(buffers[3]); } },
+                         blockSize);
+
+    std::printf("%-7d %7.1f / %6zu B %7.1f / %6zu B %7.1f / %6zu B %7.1f / %6zu B\n",
+                numStages, times[0], twoBufferSize, times[1], canonicalSize, times[2],
+                seriesSize, times[3], nestedSize);
+  }
+}
+}
@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace benchmark {
+void fillWithNoise(juce::AudioBuffer<float>& buffer, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::normal_distribution<float> noise(0.0f, 0.1f);
+
+  for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+    auto* data = buffer.getWritePointer(channel);
+
+    for (int i = 0; i < buffer.getNumSamples(); ++i) {
+      data[i] = noise(generator);
+    }
+  }
+}
+
+void copy(const juce::AudioBuffer<float>& source,
+          juce::AudioBuffer<float>& destination) {
+  jassert(destination.getNumChannels() == source.getNumChannels());
+  jassert(destination.getNumSamples() == source.getNumSamples());
+
+  for (int channel = 0; channel < source.getNumChannels(); ++channel) {
+    juce::FloatVectorOperations::copy(destination.getWritePointer(channel),
+                                      source.getReadPointer(channel),
+                                      source.getNumSamples());
+  }
+}
+
+const char* getKernelName(CombBank::Kernel kernel) {
+  switch (kernel) {
+    case CombBank::Kernel::scalar: return "scalar";
+    case CombBank::Kernel::sse2: return "sse2";
+    case CombBank::Kernel::avx2: return "avx2";
+  }
+
+  return "unknown";
+}
+
+std::vector<double> compare(const std::vector<std::function<void()>>& candidates,
+                            int framesPerCall, int numRounds, int callsPerRound) {
+  std::vector<std::vector<double>> times(candidates.size());
+
+  // An untimed round first, so every candidate starts with warm caches
+  for (auto& candidate : candidates) {
+    for (int call = 0; call < callsPerRound; ++call) {
+      candidate();
+    }
+  }
+
+  for (int round = 0; round < numRounds; ++round) {
+    for (size_t c = 0; c < candidates.size(); ++c) {
+      auto start = std::chrono::steady_clock::now();
+
+      for (int call = 0; call < callsPerRound; ++call) {
+        candidates[c]();
+      }
+
+      std::chrono::duration<double, std::nano> elapsed =
+          std::chrono::steady_clock::now() - start;
+      times[c].push_back(elapsed.count() / (callsPerRound * framesPerCall));
+    }
+  }
+
+  std::vector<double> nanosecondsPerFrame;
+
+  for (auto& candidateTimes : times) {
+    std::sort(candidateTimes.begin(), candidateTimes.end());
+    nanosecondsPerFrame.push_back(candidateTimes[candidateTimes.size() / 5]);
+  }
+
+  return nanosecondsPerFrame;
+}
+}
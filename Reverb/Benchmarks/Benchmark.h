@@ -0,0 +1,53 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "CombBank.h"
+#include <functional>
+#include <vector>
+
+/**
+ * What the reverb's benchmarks share.
+ *
+ * The machines these run on are rarely quiet, so the candidates in a
+ * comparison are timed in turn, a round of each after the other, and each
+ * is reported at the 20th percentile of its rounds. Drift in the clock
+ * speed or the load then hits every candidate alike, and rounds that were
+ * interrupted don't count.
+ */
+namespace benchmark {
+constexpr float sampleRate = 48000.0f;  // in Hz
+constexpr int blockSize = 512;          // in samples
+
+// Fills every channel with white noise at about -20 dBFS, so nothing the
+// benchmarks run goes to sleep on silence
+void fillWithNoise(juce::AudioBuffer<float>& buffer, unsigned int seed = 1);
+
+// Copies every channel of source over destination, which must be as big
+void copy(const juce::AudioBuffer<float>& source,
+          juce::AudioBuffer<float>& destination);
+
+// The name the tables print for a comb bank kernel
+const char* getKernelName(CombBank::Kernel kernel);
+
+// Times every candidate callsPerRound times a round for numRounds rounds,
+// and returns each one's ns per frame, for framesPerCall frames a call
+std::vector<double> compare(const std::vector<std::function<void()>>& candidates,
+                            int framesPerCall, int numRounds = 200,
+                            int callsPerRound = 10);
+
+// The benchmarks, each of which prints its own table
+void runFused();
+void runDelayLine();
+void runAllPass();
+void runSchroeder();
+void runQuality();
+void runDamping();
+void runSend();
+void runModulation();
+void runMultirate();
+
+// The checks, which print their results and exit with an error if they fail
+void runKernels();
+void runConvolution();
+void runResampling();
+}
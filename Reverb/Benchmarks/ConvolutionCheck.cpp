@@ -0,0 +1,132 @@
+#include "Benchmark.h"
+#include "ConvolutionEngine.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// The convolution engine against a direct convolution with the same impulse
+// response, for both partitionings and impulse responses from shorter than
+// the FIR head to well into the longest segment. The input is full-scale
+// noise, processed in place in blocks of random sizes, so partitions fill
+// across block boundaries. Exits with an error if the engine strays further
+// from the direct convolution than ConvolutionEngine::maxError
+namespace benchmark {
+namespace {
+constexpr std::array<int, 4> impulseResponseLengths { 40, 300, 3000, 20000 };  // in samples
+constexpr int numSamples = 30000;
+constexpr int maxCallSize = 700;  // in samples
+constexpr int checkedSampleStride = 7;  // only every seventh sample is convolved directly
+
+float getMaxError(ConvolutionEngine::Partitioning partitioning, int length,
+                  std::mt19937& generator) {
+  std::normal_distribution<float> gaussian;
+  std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+  // Decaying noise, scaled the same way the engine scales it, to unit energy
+  // in its loudest channel
+  juce::AudioBuffer<float> impulseResponse(2, length);
+  double maxEnergy = 0.0;
+
+  for (int channel = 0; channel < 2; ++channel) {
+    auto* taps = impulseResponse.getWritePointer(channel);
+    double energy = 0.0;
+
+    for (int i = 0; i < length; ++i) {
+      taps[i] = gaussian(generator) *
+                std::exp(-static_cast<float>(i) / (0.3f * static_cast<float>(length)));
+      energy += static_cast<double>(taps[i]) * taps[i];
+    }
+
+    maxEnergy = std::max(maxEnergy, energy);
+  }
+
+  auto gain = 1.0 / std::sqrt(maxEnergy);
+
+  ConvolutionEngine engine;
+  engine.setPartitioning(partitioning);
+  engine.prepare(sampleRate, 2);
+  engine.loadImpulseResponse(impulseResponse, sampleRate);
+
+  juce::AudioBuffer<float> input(2, numSamples), output(2, numSamples);
+
+  for (int channel = 0; channel < 2; ++channel) {
+    auto* samples = input.getWritePointer(channel);
+
+    for (int i = 0; i < numSamples; ++i) {
+      samples[i] = noise(generator);
+    }
+  }
+
+  output.makeCopyOf(input);
+  std::uniform_int_distribution<int> callSizes(1, maxCallSize);
+
+  for (int start = 0; start < numSamples;) {
+    auto callSize = std::min(numSamples - start, callSizes(generator));
+    std::array<float*, 2> channels { output.getWritePointer(0) + start,
+                                     output.getWritePointer(1) + start };
+    juce::AudioBuffer<float> block(channels.data(), 2, callSize);
+    engine.process(block, block);
+    start += callSize;
+  }
+
+  double maxError = 0.0;
+
+  for (int channel = 0; channel < 2; ++channel) {
+    auto* taps = impulseResponse.getReadPointer(channel);
+    auto* x = input.getReadPointer(channel);
+    auto* y = output.getReadPointer(channel);
+
+    for (int t = 0; t < numSamples; t += checkedSampleStride) {
+      double expected = 0.0;
+
+      for (int k = 0; k < length && k <= t; ++k) {
+        expected += static_cast<double>(taps[k]) * gain * x[t - k];
+      }
+
+      maxError = std::max(maxError, std::abs(expected - y[t]));
+    }
+  }
+
+  return static_cast<float>(maxError);
+}
+}
+
+void runConvolution() {
+  std::mt19937 generator(1);
+
+  std::printf("largest difference from direct convolution, full-scale noise\n");
+  std::printf("%-12s", "partitions");
+
+  for (auto length : impulseResponseLengths) {
+    std::printf(" %8d", length);
+  }
+
+  std::printf("  taps\n");
+
+  bool failed = false;
+
+  for (auto partitioning : { ConvolutionEngine::Partitioning::nonUniform,
+                             ConvolutionEngine::Partitioning::uniform }) {
+    std::printf("%-12s", partitioning == ConvolutionEngine::Partitioning::uniform
+                             ? "uniform"
+                             : "non-uniform");
+
+    for (auto length : impulseResponseLengths) {
+      auto error = getMaxError(partitioning, length, generator);
+      std::printf(" %8.2g", static_cast<double>(error));
+      failed = failed || error > ConvolutionEngine::maxError;
+    }
+
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("FAILED: the engine differs from direct convolution by more than %g\n",
+                static_cast<double>(ConvolutionEngine::maxError));
+    std::exit(EXIT_FAILURE);
+  }
+}
+}
@@ -0,0 +1,64 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "CombBank.h"
+#include <array>
+#include <cstdio>
+
+// A bank of eight stereo combs on each kernel the CPU runs, with the
+// damping off and halfway. The kernels run the damping recurrence either
+// way, a zero pole just leaves the feedback as it was, so the difference
+// between the two columns is only noise. What damping adds is measured
+// against the kernels from before it, by running this benchmark on the
+// commit before damping went in, with the setDamping() call taken out
+namespace benchmark {
+void runDamping() {
+  constexpr std::array<float, CombBank::maxNumCombs> delayTimes {
+    30.1f, 34.2f, 39.1f, 45.1f, 27.3f, 32.3f, 36.7f, 42.4f
+  };  // in ms
+  constexpr std::array<CombBank::Kernel, 3> kernels { CombBank::Kernel::scalar,
+                                                      CombBank::Kernel::sse2,
+                                                      CombBank::Kernel::avx2 };
+  constexpr std::array<float, 2> dampings { 0.0f, 0.5f };
+
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::printf("ns per lane and sample, %d combs of %d channels\n", CombBank::maxNumCombs, 2);
+  std::printf("%-8s %10s %10s\n", "kernel", "damping 0", "damping .5");
+
+  for (auto kernel : kernels) {
+    std::array<CombBank, 2> banks;
+    std::array<AlignedArena, 2> arenas;
+    std::array<juce::AudioBuffer<float>, 2> outputs;
+
+    for (size_t i = 0; i < banks.size(); ++i) {
+      auto& bank = banks[i];
+
+      for (int comb = 0; comb < CombBank::maxNumCombs; ++comb) {
+        bank.setDelayTime(comb, delayTimes[static_cast<size_t>(comb)]);
+        bank.setPhaseFlipped(comb, comb % 2 == 0);
+      }
+
+      bank.setInterpolated(false);
+      bank.setSampleRate(sampleRate);
+      arenas[i].reset(bank.getMemorySize(CombBank::maxNumCombs, 2));
+      bank.prepare(sampleRate, CombBank::maxNumCombs, 2, arenas[i]);
+      bank.setDamping(dampings[i]);
+      bank.setKernel(kernel);
+      outputs[i].setSize(2, blockSize);
+    }
+
+    // Kernels the CPU can't run are left out
+    if (banks[0].getKernel() != kernel)
+      continue;
+
+    auto times = compare({ [&] { banks[0].process(input, outputs[0]); },
+                           [&] { banks[1].process(input, outputs[1]); } },
+                         blockSize);
+    auto numLanes = static_cast<double>(banks[0].getNumLanes());
+
+    std::printf("%-8s %10.3f %10.3f\n", getKernelName(kernel), times[0] / numLanes,
+                times[1] / numLanes);
+  }
+}
+}
@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "PowerOfTwoDelayLine.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// One feedback loop through each delay line, a fractional read and a push
+// a sample, which is what the filters did with them before they moved to
+// block reads. The delay line the filters started out with wraps with
+// modulos and PowerOfTwoDelayLine with a mask
+namespace benchmark {
+namespace {
+// The filters' original delay line, kept here as the reference. It writes
+// backwards and sizes its buffer to the delay, so both of its indices wrap
+// with a modulo
+class ModuloDelayLine {
+public:
+  void push(float sample) {
+    buffer[writeIndex] = sample;
+    writeIndex = writeIndex == 0 ? buffer.size() - 1 : writeIndex - 1;
+  }
+
+  void resize(float delayTimeInSamples) {
+    // get() reads the sample after the delay too
+    buffer.assign(static_cast<size_t>(std::floor(delayTimeInSamples)) + 2, 0.0f);
+    writeIndex = 0;
+  }
+
+  float get(float delayTimeInSamples) const {
+    auto leftSampleIndex = static_cast<size_t>(std::floor(delayTimeInSamples));
+    auto rightSampleIndex = (leftSampleIndex + 1) % buffer.size();
+    auto fraction = delayTimeInSamples - static_cast<float>(leftSampleIndex);
+
+    auto leftSample = buffer[(writeIndex + 1 + leftSampleIndex) % buffer.size()];
+    auto rightSample = buffer[(writeIndex + 1 + rightSampleIndex) % buffer.size()];
+
+    return leftSample + fraction * (rightSample - leftSample);
+  }
+
+private:
+  std::vector<float> buffer;
+  size_t writeIndex = 0;
+};
+
+template <typename Line>
+void runFeedbackLoop(Line& line, const float* input, int numSamples) noexcept {
+  constexpr float delay = 1444.8f;  // in samples, 30.1 ms at 48 kHz
+  constexpr float feedback = 0.7f;
+
+  for (int i = 0; i < numSamples; ++i) {
+    line.push(input[i] + feedback * line.get(delay));
+  }
+}
+}
+
+void runDelayLine() {
+  constexpr float delay = 1444.8f;
+
+  juce::AudioBuffer<float> input(1, blockSize);
+  fillWithNoise(input);
+  auto* samples = input.getReadPointer(0);
+
+  ModuloDelayLine moduloLine;
+  moduloLine.resize(delay);
+
+  AlignedArena arena;
+  auto maskSize = PowerOfTwoDelayLine::getRequiredSize(delay);
+  arena.reset(AlignedArena::getAllocationSize<float>(static_cast<size_t>(maskSize)));
+  PowerOfTwoDelayLine maskLine;
+  maskLine.setMemory(arena.allocate<float>(static_cast<size_t>(maskSize)), maskSize);
+
+  auto times = compare({ [&] { runFeedbackLoop(moduloLine, samples, blockSize); },
+                         [&] { runFeedbackLoop(maskLine, samples, blockSize); } },
+                       blockSize);
+
+  std::printf("ns per sample of a %.1f sample feedback loop\n", static_cast<double>(delay));
+  std::printf("%-22s %6.2f\n", "modulo", times[0]);
+  std::printf("%-22s %6.2f\n", "PowerOfTwoDelayLine", times[1]);
+}
+}
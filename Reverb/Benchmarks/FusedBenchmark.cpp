@@ -0,0 +1,45 @@
+#include "Benchmark.h"
+#include "Reverb.h"
+#include <array>
+#include <cstdio>
+
+// The Schroeder engine's two wet paths on the same stereo noise, for each
+// quality tier. Multi-pass walks the block once per stage, fused takes each
+// sample through every stage in one trip, so the difference is the cost of
+// the passes over the intermediate buffers. A profiler run on this
+// benchmark alone shows the memory traffic behind it
+namespace benchmark {
+void runFused() {
+  constexpr std::array<Reverb::Quality, 3> qualities { Reverb::Quality::eco,
+                                                       Reverb::Quality::standard,
+                                                       Reverb::Quality::high };
+  constexpr std::array<const char*, 3> qualityNames { "eco", "standard", "high" };
+
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::printf("ns per stereo frame, %d sample blocks at %.0f Hz\n", blockSize,
+              static_cast<double>(sampleRate));
+  std::printf("%-10s %10s %10s\n", "quality", "multi-pass", "fused");
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    std::array<Reverb, 2> reverbs;
+    std::array<juce::AudioBuffer<float>, 2> buffers;
+
+    for (size_t mode = 0; mode < reverbs.size(); ++mode) {
+      reverbs[mode].prepare(sampleRate, blockSize, 2);
+      reverbs[mode].setEngine(Reverb::Engine::schroeder);
+      reverbs[mode].setQuality(qualities[q]);
+      reverbs[mode].setProcessingMode(mode == 0 ? Reverb::ProcessingMode::multiPass
+                                                : Reverb::ProcessingMode::fused);
+      buffers[mode].setSize(2, blockSize);
+    }
+
+    auto times = compare({ [&] { copy(input, buffers[0]); reverbs[0].process(buffers[0]); },
+                           [&] { copy(input, buffers[1]); reverbs[1].process(buffers[1]); } },
+                         blockSize);
+
+    std::printf("%-10s %10.1f %10.1f\n", qualityNames[q], times[0], times[1]);
+  }
+}
+}
@@ -0,0 +1,165 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "CombBank.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Every SIMD comb bank kernel the CPU runs against the scalar one, on full-scale
+// noise, for mono and stereo banks of four and eight combs. A mono bank of
+// four is padded out to eight lanes when AVX2 is available, so that layout
+// is covered too. Along the way the feedback ramps to a new decay, the taps
+// crossfade to a new delay scale and the delays are modulated, with the
+// combs damped throughout, so every kernel variant runs. Exits with an
+// error if any kernel strays further from the scalar one than
+// CombBank::maxKernelError
+namespace benchmark {
+namespace {
+constexpr std::array<float, CombBank::maxNumCombs> delayTimes {
+  30.1f, 34.2f, 39.1f, 45.1f, 27.3f, 32.3f, 36.7f, 42.4f
+};  // in ms
+constexpr std::array<CombBank::Kernel, 2> kernels { CombBank::Kernel::sse2,
+                                                    CombBank::Kernel::avx2 };
+constexpr int numBlocks = 120;
+
+// The modulation's lines. The first is cut short, as the LFOs' usually is
+constexpr int firstLineLength = 13;
+constexpr int lineLength = 32;
+
+void fillWithFullScaleNoise(juce::AudioBuffer<float>& buffer, unsigned int seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+  for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+    auto* data = buffer.getWritePointer(channel);
+
+    for (int i = 0; i < buffer.getNumSamples(); ++i) {
+      data[i] = noise(generator);
+    }
+  }
+}
+
+// The largest difference between the kernel's output and the scalar
+// kernel's, or a negative number if the CPU can't run the kernel
+float getMaxError(CombBank::Kernel kernel, int numCombs, int numChannels,
+                  const std::vector<float>& lines) {
+  std::array<CombBank, 2> banks;
+  std::array<AlignedArena, 2> arenas;
+  std::array<juce::AudioBuffer<float>, 2> outputs;
+
+  for (size_t i = 0; i < banks.size(); ++i) {
+    auto& bank = banks[i];
+
+    for (int comb = 0; comb < numCombs; ++comb) {
+      bank.setDelayTime(comb, delayTimes[static_cast<size_t>(comb)]);
+      bank.setPhaseFlipped(comb, comb % 2 == 0);
+    }
+
+    bank.setSampleRate(sampleRate);
+    arenas[i].reset(bank.getMemorySize(numCombs, numChannels));
+    bank.prepare(sampleRate, numCombs, numChannels, arenas[i]);
+    bank.setDamping(0.5f);
+    bank.setKernel(i == 0 ? CombBank::Kernel::scalar : kernel);
+    outputs[i].setSize(numChannels, blockSize);
+  }
+
+  if (banks[1].getKernel() != kernel)
+    return -1.0f;
+
+  juce::AudioBuffer<float> input(numChannels, blockSize);
+  float maxError = 0.0f;
+
+  for (int block = 0; block < numBlocks; ++block) {
+    fillWithFullScaleNoise(input, static_cast<unsigned int>(block));
+
+    for (size_t i = 0; i < banks.size(); ++i) {
+      auto& bank = banks[i];
+
+      if (block == 30)
+        bank.setFeedback(3.0f);
+
+      // One crossfade while the delays are modulated, and one after
+      if (block == 50)
+        bank.setDelayScale(1.2f);
+
+      if (block == 100)
+        bank.setDelayScale(0.9f);
+
+      auto modulated = block >= 40 && block < 90;
+      bank.setModulation(modulated ? lines.data() : nullptr, firstLineLength, lineLength);
+      bank.process(input, outputs[i]);
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto* reference = outputs[0].getReadPointer(channel);
+      auto* output = outputs[1].getReadPointer(channel);
+
+      for (int i = 0; i < blockSize; ++i) {
+        maxError = std::max(maxError, std::abs(output[i] - reference[i]));
+      }
+    }
+  }
+
+  return maxError;
+}
+}
+
+void runKernels() {
+  // Lines along offsets of up to 20 samples either way, a different phase
+  // for each lane, each a row of offsets and a row of steps
+  auto getOffset = [](int sample, int lane) {
+    return 20.0f * std::sin(0.01f * static_cast<float>(sample) + static_cast<float>(lane));
+  };
+
+  std::vector<float> lines;
+
+  for (int start = 0, length = firstLineLength; start < blockSize;
+       start += length, length = lineLength) {
+    std::array<float, CombBank::maxNumLanes> values, steps;
+
+    for (int lane = 0; lane < CombBank::maxNumLanes; ++lane) {
+      auto l = static_cast<size_t>(lane);
+      values[l] = getOffset(start, lane);
+      steps[l] = (getOffset(start + length, lane) - values[l]) / static_cast<float>(length);
+    }
+
+    lines.insert(lines.end(), values.begin(), values.end());
+    lines.insert(lines.end(), steps.begin(), steps.end());
+  }
+
+  std::printf("largest difference from the scalar kernel, full-scale noise\n");
+  std::printf("%-8s %10s %10s %10s %10s\n", "kernel", "mono 4", "mono 8", "stereo 4",
+              "stereo 8");
+
+  bool failed = false;
+
+  for (auto kernel : kernels) {
+    std::printf("%-8s", getKernelName(kernel));
+
+    for (int numChannels : { 1, 2 }) {
+      for (int numCombs : { 4, 8 }) {
+        auto error = getMaxError(kernel, numCombs, numChannels, lines);
+
+        if (error < 0.0f) {
+          std::printf(" %10s", "-");
+          continue;
+        }
+
+        std::printf(" %10.2g", static_cast<double>(error));
+        failed = failed || error > CombBank::maxKernelError;
+      }
+    }
+
+    std::printf("\n");
+  }
+
+  if (failed) {
+    std::printf("FAILED: a kernel differs from the scalar one by more than %g\n",
+                static_cast<double>(CombBank::maxKernelError));
+    std::exit(EXIT_FAILURE);
+  }
+}
+}
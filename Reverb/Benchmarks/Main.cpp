@@ -0,0 +1,67 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+struct Entry {
+  const char* name;
+  const char* description;
+  void (*run)();
+};
+
+const Entry benchmarks[] = {
+  { "fused", "multi-pass against fused processing, for every quality tier", benchmark::runFused },
+  { "delayline", "modulo against power-of-two delay lines in a feedback loop", benchmark::runDelayLine },
+  { "allpass", "two-buffer against canonical all-passes and AllPassChain", benchmark::runAllPass },
+  { "schroeder", "SchroederNetwork instantiations against CombBank and AllPassChain", benchmark::runSchroeder },
+  { "quality", "what one instance costs on each quality tier", benchmark::runQuality },
+  { "damping", "comb bank kernels with and without damping", benchmark::runDamping },
+  { "send", "stereo against send mode, fully wet, for every quality tier", benchmark::runSend },
+  { "modulation", "stereo with the modulation off and at full depth, for every quality tier", benchmark::runModulation },
+  { "multirate", "full rate against multirate networks at 96 and 192 kHz", benchmark::runMultirate },
+  { "kernels", "checks every comb bank kernel against the scalar one", benchmark::runKernels },
+  { "convolution", "checks the convolution engine against direct convolution", benchmark::runConvolution },
+  { "resampling", "checks the multirate path's latency, passband and stopband", benchmark::runResampling },
+};
+
+void printUsage() {
+  std::printf("usage: ReverbBenchmarks [name...]\n\n"
+              "Runs the named benchmarks, or all of them with no names:\n");
+
+  for (const auto& entry : benchmarks) {
+    std::printf("  %-12s %s\n", entry.name, entry.description);
+  }
+}
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 1) {
+    for (const auto& entry : benchmarks) {
+      std::printf("== %s\n", entry.name);
+      entry.run();
+      std::printf("\n");
+    }
+
+    return 0;
+  }
+
+  for (int arg = 1; arg < argc; ++arg) {
+    const Entry* found = nullptr;
+
+    for (const auto& entry : benchmarks) {
+      if (std::strcmp(argv[arg], entry.name) == 0)
+        found = &entry;
+    }
+
+    if (found == nullptr) {
+      printUsage();
+      return 1;
+    }
+
+    std::printf("== %s\n", found->name);
+    found->run();
+    std::printf("\n");
+  }
+
+  return 0;
+}
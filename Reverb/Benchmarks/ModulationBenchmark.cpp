@@ -0,0 +1,71 @@
+#include "Benchmark.h"
+#include "Reverb.h"
+#include <array>
+#include <cstdio>
+
+// What turning the modulation up adds to a stereo instance, on each quality
+// tier in both processing modes. Each instance runs the Schroeder engine on
+// noise with the modulation off and at full depth, all in the same
+// comparison, and the last column is the second over the first
+namespace benchmark {
+namespace {
+constexpr std::array<Reverb::Quality, 3> qualities { Reverb::Quality::eco,
+                                                     Reverb::Quality::standard,
+                                                     Reverb::Quality::high };
+constexpr std::array<const char*, 3> qualityNames { "eco", "standard", "high" };
+constexpr std::array<Reverb::ProcessingMode, 2> modes { Reverb::ProcessingMode::multiPass,
+                                                        Reverb::ProcessingMode::fused };
+constexpr std::array<const char*, 2> modeNames { "multi", "fused" };
+constexpr std::array<float, 2> modulations { 0.0f, 1.0f };
+
+constexpr size_t numInstances = qualities.size() * modes.size() * modulations.size();
+}
+
+void runModulation() {
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::array<Reverb, numInstances> reverbs;
+  std::array<juce::AudioBuffer<float>, numInstances> buffers;
+  std::vector<std::function<void()>> candidates;
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    for (size_t mode = 0; mode < modes.size(); ++mode) {
+      for (size_t m = 0; m < modulations.size(); ++m) {
+        auto instance = (q * modes.size() + mode) * modulations.size() + m;
+        auto& reverb = reverbs[instance];
+        auto& buffer = buffers[instance];
+
+        reverb.prepare(sampleRate, blockSize, 2);
+        reverb.setEngine(Reverb::Engine::schroeder);
+        reverb.setQuality(qualities[q]);
+        reverb.setProcessingMode(modes[mode]);
+        reverb.setModulation(modulations[m]);
+        buffer.setSize(2, blockSize);
+
+        candidates.push_back([&reverb, &buffer, &input] {
+          copy(input, buffer);
+          reverb.process(buffer);
+        });
+      }
+    }
+  }
+
+  auto times = compare(candidates, blockSize);
+
+  std::printf("ns per stereo frame, %d sample blocks, CombBank kernel %s\n", blockSize,
+              getKernelName(CombBank::getBestAvailableKernel()));
+  std::printf("%-10s %-6s %8s %8s %8s\n", "quality", "mode", "off", "full", "cost");
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    for (size_t mode = 0; mode < modes.size(); ++mode) {
+      auto instance = (q * modes.size() + mode) * modulations.size();
+      auto off = times[instance];
+      auto full = times[instance + 1];
+
+      std::printf("%-10s %-6s %8.1f %8.1f %7.0f%%\n", qualityNames[q], modeNames[mode], off,
+                  full, 100.0 * (full / off - 1.0));
+    }
+  }
+}
+}
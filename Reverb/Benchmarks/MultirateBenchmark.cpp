@@ -0,0 +1,65 @@
+#include "Benchmark.h"
+#include "Reverb.h"
+#include <array>
+#include <cstdio>
+
+// What a stereo instance costs at high sample rates with the networks run
+// at the full rate and through the multirate path, for each engine that can
+// be resampled. Each runs at Standard quality, wet and dry, on noise, and
+// every instance is timed in the same comparison. The last column is how
+// many times cheaper the multirate instance is
+namespace benchmark {
+namespace {
+constexpr std::array<float, 2> sampleRates { 96000.0f, 192000.0f };  // in Hz
+constexpr std::array<Reverb::Engine, 2> engines { Reverb::Engine::schroeder,
+                                                  Reverb::Engine::feedbackDelayNetwork };
+constexpr std::array<const char*, 2> engineNames { "schroeder", "fdn" };
+
+constexpr size_t numInstances = sampleRates.size() * engines.size() * 2;
+}
+
+void runMultirate() {
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::array<Reverb, numInstances> reverbs;
+  std::array<juce::AudioBuffer<float>, numInstances> buffers;
+  std::vector<std::function<void()>> candidates;
+
+  for (size_t rate = 0; rate < sampleRates.size(); ++rate) {
+    for (size_t engine = 0; engine < engines.size(); ++engine) {
+      for (size_t multirate = 0; multirate < 2; ++multirate) {
+        auto instance = (rate * engines.size() + engine) * 2 + multirate;
+        auto& reverb = reverbs[instance];
+        auto& buffer = buffers[instance];
+
+        reverb.setMultirateEnabled(multirate == 1);
+        reverb.prepare(sampleRates[rate], blockSize, 2);
+        reverb.setEngine(engines[engine]);
+        buffer.setSize(2, blockSize);
+
+        candidates.push_back([&reverb, &buffer, &input] {
+          copy(input, buffer);
+          reverb.process(buffer);
+        });
+      }
+    }
+  }
+
+  auto times = compare(candidates, blockSize);
+
+  std::printf("ns per stereo frame, %d sample blocks, Standard quality\n", blockSize);
+  std::printf("%-8s %-10s %10s %10s %7s\n", "rate", "engine", "full rate", "multirate",
+              "saving");
+
+  for (size_t rate = 0; rate < sampleRates.size(); ++rate) {
+    for (size_t engine = 0; engine < engines.size(); ++engine) {
+      auto instance = (rate * engines.size() + engine) * 2;
+
+      std::printf("%-8.0f %-10s %10.1f %10.1f %6.2fx\n",
+                  static_cast<double>(sampleRates[rate]), engineNames[engine],
+                  times[instance], times[instance + 1], times[instance] / times[instance + 1]);
+    }
+  }
+}
+}
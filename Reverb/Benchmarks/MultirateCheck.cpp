@@ -0,0 +1,124 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "MultirateWetPath.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// The multirate path at every high sample rate it runs at, with nothing
+// between its decimators and interpolators, fed in blocks of random sizes.
+// A sine in the passband has to come back out at exactly the latency the
+// path reports, to within MultirateWetPath::maxPassbandError, and a sine
+// that would alias onto the passband has to come back at least
+// MultirateWetPath::stopbandAttenuation down. Exits with an error if
+// either doesn't
+namespace benchmark {
+namespace {
+constexpr std::array<float, 4> sampleRates { 88200.0f, 96000.0f, 176400.0f, 192000.0f };  // in Hz
+constexpr int numSamples = 60000;
+constexpr int maxCallSize = 700;    // in samples
+constexpr int settlingTime = 2000;  // left out at the start, in samples
+
+struct SineResult {
+  float maxError;  // from the sine delayed by the latency
+  float gain;      // the output's RMS over the input's
+  int latency;     // in samples
+};
+
+SineResult runSine(float rate, float frequency, std::mt19937& generator) {
+  auto factor = MultirateWetPath::getFactorFor(rate);
+  MultirateWetPath path;
+  AlignedArena arena;
+  arena.reset(MultirateWetPath::getMemorySize(rate, factor, 2, maxCallSize));
+  path.prepare(rate, factor, 2, maxCallSize, arena);
+
+  auto latency = path.getLatencySamples();
+  auto omega = juce::MathConstants<double>::twoPi * static_cast<double>(frequency / rate);
+  auto getInput = [omega](int t) { return static_cast<float>(std::sin(omega * t)); };
+
+  juce::AudioBuffer<float> block(2, maxCallSize), network(2, maxCallSize);
+  std::uniform_int_distribution<int> callSizes(1, maxCallSize);
+  double maxError = 0.0, outputEnergy = 0.0, inputEnergy = 0.0;
+
+  for (int start = 0; start < numSamples;) {
+    auto callSize = std::min(numSamples - start, callSizes(generator));
+
+    for (int channel = 0; channel < 2; ++channel) {
+      auto* samples = block.getWritePointer(channel);
+
+      for (int i = 0; i < callSize; ++i) {
+        samples[i] = getInput(start + i);
+      }
+    }
+
+    juce::AudioBuffer<float> input(block.getArrayOfWritePointers(), 2, callSize);
+    juce::AudioBuffer<float> decimated(network.getArrayOfWritePointers(), 2,
+                                       path.getNumNetworkSamples(callSize));
+    path.decimate(input, decimated);
+    path.interpolate(decimated, input);
+
+    for (int channel = 0; channel < 2; ++channel) {
+      auto* samples = block.getReadPointer(channel);
+
+      for (int i = 0; i < callSize; ++i) {
+        auto t = start + i;
+
+        if (t < settlingTime + latency)
+          continue;
+
+        auto output = static_cast<double>(samples[i]);
+        auto expected = static_cast<double>(getInput(t - latency));
+        maxError = std::max(maxError, std::abs(output - expected));
+        outputEnergy += output * output;
+        inputEnergy += expected * expected;
+      }
+    }
+
+    start += callSize;
+  }
+
+  return { static_cast<float>(maxError),
+           static_cast<float>(std::sqrt(outputEnergy / inputEnergy)), latency };
+}
+}
+
+void runResampling() {
+  std::mt19937 generator(1);
+  auto edge = MultirateWetPath::passbandEdge;
+
+  std::printf("passband: largest difference from the sine delayed by the latency\n");
+  std::printf("stopband: how far down a sine that would alias onto the passband comes back\n");
+  std::printf("%-8s %6s %8s %10s %10s %11s\n", "rate", "factor", "latency", "1 kHz",
+              "edge", "stopband");
+
+  bool failed = false;
+
+  for (auto rate : sampleRates) {
+    auto factor = MultirateWetPath::getFactorFor(rate);
+    auto networkRate = rate / static_cast<float>(factor);
+
+    auto low = runSine(rate, 1000.0f, generator);
+    auto high = runSine(rate, edge, generator).maxError;
+    auto alias = runSine(rate, networkRate - 0.5f * edge, generator).gain;
+    auto rejection = -juce::Decibels::gainToDecibels(alias, -300.0f);
+
+    std::printf("%-8.0f %6d %8d %10.2g %10.2g %8.1f dB\n", static_cast<double>(rate), factor,
+                low.latency, static_cast<double>(low.maxError), static_cast<double>(high),
+                static_cast<double>(rejection));
+
+    failed = failed || std::max(low.maxError, high) > MultirateWetPath::maxPassbandError ||
+             rejection < MultirateWetPath::stopbandAttenuation;
+  }
+
+  if (failed) {
+    std::printf("FAILED: the passband is out by more than %g, or the stopband is less than "
+                "%g dB down\n",
+                static_cast<double>(MultirateWetPath::maxPassbandError),
+                static_cast<double>(MultirateWetPath::stopbandAttenuation));
+    std::exit(EXIT_FAILURE);
+  }
+}
+}
@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+#include "Reverb.h"
+#include <array>
+#include <cstdio>
+
+// What one Reverb instance costs on each quality tier, for mono and stereo
+// tracks in both processing modes, which is what sessions are budgeted
+// from. Each instance runs the Schroeder engine at its defaults, wet and
+// dry, on noise. Every instance is timed in the same comparison, so the
+// whole table sees the same clock speed
+namespace benchmark {
+namespace {
+constexpr std::array<Reverb::Quality, 3> qualities { Reverb::Quality::eco,
+                                                     Reverb::Quality::standard,
+                                                     Reverb::Quality::high };
+constexpr std::array<const char*, 3> qualityNames { "eco", "standard", "high" };
+constexpr std::array<int, 2> channelCounts { 1, 2 };
+constexpr std::array<Reverb::ProcessingMode, 2> modes { Reverb::ProcessingMode::multiPass,
+                                                        Reverb::ProcessingMode::fused };
+
+// Per tier, a column for each channel count in each mode
+constexpr size_t numColumns = channelCounts.size() * modes.size();
+constexpr size_t numInstances = qualities.size() * numColumns;
+}
+
+void runQuality() {
+  std::array<juce::AudioBuffer<float>, channelCounts.size()> inputs;
+
+  for (size_t c = 0; c < channelCounts.size(); ++c) {
+    inputs[c].setSize(channelCounts[c], blockSize);
+    fillWithNoise(inputs[c]);
+  }
+
+  std::array<Reverb, numInstances> reverbs;
+  std::array<juce::AudioBuffer<float>, numInstances> buffers;
+  std::vector<std::function<void()>> candidates;
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    for (size_t c = 0; c < channelCounts.size(); ++c) {
+      for (size_t mode = 0; mode < modes.size(); ++mode) {
+        auto instance = (q * channelCounts.size() + c) * modes.size() + mode;
+        auto& reverb = reverbs[instance];
+        auto& buffer = buffers[instance];
+        auto& input = inputs[c];
+
+        reverb.prepare(sampleRate, blockSize, channelCounts[c]);
+        reverb.setEngine(Reverb::Engine::schroeder);
+        reverb.setQuality(qualities[q]);
+        reverb.setProcessingMode(modes[mode]);
+        buffer.setSize(channelCounts[c], blockSize);
+
+        candidates.push_back([&reverb, &buffer, &input] {
+          copy(input, buffer);
+          reverb.process(buffer);
+        });
+      }
+    }
+  }
+
+  auto times = compare(candidates, blockSize);
+
+  std::printf("ns per sample frame of one instance, %d sample blocks at %.0f Hz\n",
+              blockSize, static_cast<double>(sampleRate));
+  std::printf("%-10s %12s %12s %12s %12s\n", "quality", "mono multi", "mono fused",
+              "stereo multi", "stereo fused");
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    std::printf("%-10s", qualityNames[q]);
+
+    for (size_t column = 0; column < numColumns; ++column) {
+      std::printf(" %12.1f", times[q * numColumns + column]);
+    }
+
+    std::printf("\n");
+  }
+}
+}
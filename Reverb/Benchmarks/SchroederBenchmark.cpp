@@ -0,0 +1,97 @@
+#include "Benchmark.h"
+#include "AlignedArena.h"
+#include "AllPassChain.h"
+#include "CombBank.h"
+#include "SchroederNetwork.h"
+#include <cstdio>
+
+// Each SchroederNetwork instantiation against the same network built at
+// run time out of CombBank and AllPassChain, the way Reverb builds its
+// own. Both run whole delays and write only the wet signal. CombBank stops
+// at maxNumCombs, so the largest network has no runtime counterpart
+namespace benchmark {
+namespace {
+template <typename Config>
+class RuntimeNetwork {
+public:
+  static constexpr int numCombs = static_cast<int>(Config::combDelayTimes.size());
+  static constexpr int numAllPasses = static_cast<int>(Config::allPassDelayTimes.size());
+
+  void prepare(AlignedArena& arena) {
+    for (int i = 0; i < numCombs; ++i) {
+      combs.setDelayTime(i, Config::combDelayTimes[static_cast<size_t>(i)]);
+      combs.setPhaseFlipped(i, Config::combSigns[static_cast<size_t>(i)] < 0.0f);
+    }
+
+    combs.setInterpolated(false);
+    combs.setSampleRate(sampleRate);
+
+    allPasses.setNumStages(numAllPasses);
+    allPasses.setSampleRate(sampleRate);
+
+    for (int i = 0; i < numAllPasses; ++i) {
+      allPasses.setDelayTime(i, Config::allPassDelayTimes[static_cast<size_t>(i)]);
+      allPasses.setFeedback(i, Config::allPassFeedback);
+    }
+
+    arena.reset(combs.getMemorySize(numCombs, 2) + allPasses.getMemorySize(2));
+    combs.prepare(sampleRate, numCombs, 2, arena);
+    allPasses.prepare(sampleRate, 2, arena);
+  }
+
+  void process(const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output) {
+    combs.process(input, output);
+    allPasses.process(output);
+  }
+
+private:
+  CombBank combs;
+  AllPassChain allPasses;
+};
+
+template <typename Network>
+void prepareTemplate(Network& network, AlignedArena& arena) {
+  arena.reset(Network::getMemorySize(sampleRate, 2));
+  network.prepare(sampleRate, 2, arena);
+}
+
+template <typename Network, typename Config>
+void printComparison(const char* name, const juce::AudioBuffer<float>& input) {
+  juce::AudioBuffer<float> runtimeOutput(2, blockSize), templateOutput(2, blockSize);
+
+  RuntimeNetwork<Config> runtime;
+  AlignedArena runtimeArena;
+  runtime.prepare(runtimeArena);
+
+  Network network;
+  AlignedArena templateArena;
+  prepareTemplate(network, templateArena);
+
+  auto times = compare({ [&] { runtime.process(input, runtimeOutput); },
+                         [&] { network.process(input, templateOutput); } },
+                       blockSize);
+
+  std::printf("%-16s %8.1f %9.1f\n", name, times[0], times[1]);
+}
+}
+
+void runSchroeder() {
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::printf("ns per stereo frame, %d sample blocks, CombBank kernel %s\n", blockSize,
+              getKernelName(CombBank::getBestAvailableKernel()));
+  std::printf("%-16s %8s %9s\n", "network", "runtime", "template");
+
+  printComparison<ClassicSchroeder, ClassicSchroederConfig>("classic 4/2", input);
+  printComparison<Freeverb, FreeverbConfig>("freeverb 8/4", input);
+
+  LargeSchroeder large;
+  AlignedArena largeArena;
+  prepareTemplate(large, largeArena);
+
+  juce::AudioBuffer<float> output(2, blockSize);
+  auto largeTime = compare({ [&] { large.process(input, output); } }, blockSize)[0];
+  std::printf("%-16s %8s %9.1f\n", "large 12/6", "-", largeTime);
+}
+}
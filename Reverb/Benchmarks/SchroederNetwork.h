@@ -0,0 +1,420 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AlignedArena.h"
+#include "Coefficients.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+/**
+ * Parallel feedback combs into series all-passes, with the number of each
+ * and all of their delays fixed at compile time.
+ *
+ * CombBank and AllPassChain take their counts and delays at run time, so
+ * their loops run over however many filters were set up, padded out to
+ * whole SIMD registers. Here the counts are template parameters and the
+ * delays come from the Config's constexpr tables, so the loops over the
+ * combs have a fixed length the compiler vectorises and unrolls for
+ * whatever the target has, and the all-pass stages are unrolled by
+ * forEachIndex() with their masks and read offsets kept in registers.
+ *
+ * The Config provides:
+ *   static constexpr std::array<float, NumCombs> combDelayTimes;        // ms
+ *   static constexpr std::array<float, NumCombs> combSigns;             // +-1
+ *   static constexpr std::array<float, NumAllPasses> allPassDelayTimes; // ms
+ *   static constexpr float allPassFeedback;
+ *
+ * As in CombBank, the combs share one ring whose rows hold a lane for every
+ * comb and channel, and each all-pass stage has a ring of both channels as
+ * in AllPassChain. The right channel's delays are longer by the stereo
+ * spread, and delays are rounded to whole samples. The recurrences and the
+ * log domain feedback ramp are CombBank's and AllPassChain's series form,
+ * so the network ClassicSchroederConfig describes is the one Reverb builds
+ * out of those.
+ *
+ * The plugin doesn't use it, so it lives with the benchmark that compares
+ * it against that runtime network.
+ */
+template <int NumCombs, int NumAllPasses, typename Config>
+class SchroederNetwork {
+public:
+  static constexpr int maxNumChannels = 2;
+  static constexpr int maxStereoSpread = 256;  // in samples
+  static constexpr float feedbackRampTime = 0.02f;  // in seconds
+
+  static_assert(NumCombs > 0 && NumAllPasses > 0);
+  static_assert(Config::combDelayTimes.size() == NumCombs);
+  static_assert(Config::combSigns.size() == NumCombs);
+  static_assert(Config::allPassDelayTimes.size() == NumAllPasses);
+
+  // Bytes prepare() takes from the arena at this sample rate
+  static size_t getMemorySize(float samplingRate, int numberOfChannels) {
+    auto size = AlignedArena::getAllocationSize<float>(
+        static_cast<size_t>(getCombRingRows(samplingRate) * NumCombs * numberOfChannels));
+
+    forEachIndex<NumAllPasses>([&](auto stage) {
+      size += AlignedArena::getAllocationSize<float>(static_cast<size_t>(
+          getRingRows(Config::allPassDelayTimes[stage], samplingRate) * numberOfChannels));
+    });
+
+    return size;
+  }
+
+  // The rings are taken from the arena, which must outlive the network
+  void prepare(float samplingRate, int numberOfChannels, AlignedArena& arena) {
+    jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+    sampleRate = samplingRate;
+    numChannels = numberOfChannels;
+
+    auto combRows = getCombRingRows(sampleRate);
+    combRing = arena.allocate<float>(static_cast<size_t>(combRows * NumCombs * numChannels));
+    combMask = combRows - 1;
+
+    forEachIndex<NumAllPasses>([&](auto stage) {
+      auto rows = getRingRows(Config::allPassDelayTimes[stage], sampleRate);
+      allPassRings[stage] = arena.allocate<float>(static_cast<size_t>(rows * numChannels));
+      allPassMasks[stage] = rows - 1;
+    });
+
+    writePosition = 0;
+    updateDelays();
+
+    feedbackCache.invalidate();
+    updateFeedback(false);
+  }
+
+  void reset() noexcept {
+    std::fill(combRing, combRing + (combMask + 1) * NumCombs * numChannels, 0.0f);
+
+    forEachIndex<NumAllPasses>([this](auto stage) {
+      std::fill(allPassRings[stage],
+                allPassRings[stage] + (allPassMasks[stage] + 1) * numChannels, 0.0f);
+    });
+
+    writePosition = 0;
+    finishFeedbackRamp();
+  }
+
+  // Ramps every comb's feedback to the one that decays it by 60 dB in decay
+  // seconds
+  void setDecay(float decay) {
+    decayTime = decay;
+    updateFeedback(true);
+  }
+
+  // Lengthens every delay of the right channel by this many samples. The
+  // rings always have room for maxStereoSpread
+  void setStereoSpread(int samples) {
+    jassert(samples >= 0 && samples <= maxStereoSpread);
+    stereoSpread = samples;
+    updateDelays();
+
+    feedbackCache.invalidate();
+    updateFeedback(false);
+  }
+
+  // The largest magnitude of anything in the network's rings
+  float getPeakLevel() const noexcept {
+    float peak = 0.0f;
+
+    auto scan = [&peak](const float* ring, int numFloats) {
+      auto range = juce::FloatVectorOperations::findMinAndMax(ring, numFloats);
+      peak = std::max({ peak, -range.getStart(), range.getEnd() });
+    };
+
+    scan(combRing, (combMask + 1) * NumCombs * numChannels);
+
+    forEachIndex<NumAllPasses>([&](auto stage) {
+      scan(allPassRings[stage], (allPassMasks[stage] + 1) * numChannels);
+    });
+
+    return peak;
+  }
+
+  // Runs the input through the network and writes only the wet signal. The
+  // two buffers may be the same
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output) {
+    jassert(input.getNumChannels() == numChannels);
+    jassert(output.getNumChannels() == numChannels);
+
+    auto* inputData = input.getArrayOfReadPointers();
+    auto* outputData = output.getArrayOfWritePointers();
+    auto numSamples = input.getNumSamples();
+
+    // As in CombBank, only the samples a ramp covers run the ramping loop
+    auto rampEnd = std::min(numSamples, rampSamplesRemaining);
+
+    if (rampEnd > 0) {
+      processRange<true>(inputData, outputData, 0, rampEnd);
+      advanceFeedbackRamp(rampEnd);
+    }
+
+    if (rampEnd < numSamples) {
+      processRange<false>(inputData, outputData, rampEnd, numSamples);
+    }
+  }
+
+private:
+  // One lane per comb per channel, all of the left channel's first
+  static constexpr int numLanes = NumCombs * maxNumChannels;
+  using LaneFloats = std::array<float, static_cast<size_t>(numLanes)>;
+
+  // Calls function(std::integral_constant<size_t, i>) for every i below
+  // Count, unrolled at compile time
+  template <int Count, typename Function>
+  static void forEachIndex(Function&& function) {
+    forEachIndex(std::forward<Function>(function),
+                 std::make_index_sequence<static_cast<size_t>(Count)>());
+  }
+
+  template <typename Function, size_t... Indices>
+  static void forEachIndex(Function&& function, std::index_sequence<Indices...>) {
+    (function(std::integral_constant<size_t, Indices>()), ...);
+  }
+
+  static int getDelayInSamples(float delayTime, float samplingRate) {
+    return static_cast<int>(std::round((delayTime / 1000.0f) * samplingRate));
+  }
+
+  // Room for the delay with the most spread, plus the row being written
+  static int getRingRows(float delayTime, float samplingRate) {
+    return juce::nextPowerOfTwo(getDelayInSamples(delayTime, samplingRate) +
+                                maxStereoSpread + 2);
+  }
+
+  static int getCombRingRows(float samplingRate) {
+    constexpr auto longestDelayTime = *std::max_element(
+        Config::combDelayTimes.begin(), Config::combDelayTimes.end());
+    return getRingRows(longestDelayTime, samplingRate);
+  }
+
+  void updateDelays() {
+    for (int channel = 0; channel < maxNumChannels; ++channel) {
+      forEachIndex<NumCombs>([&](auto comb) {
+        auto lane = static_cast<size_t>(channel * NumCombs) + comb;
+        auto delay = getDelayInSamples(Config::combDelayTimes[comb], sampleRate) +
+                     channel * stereoSpread;
+
+        // The combs read y[n - 1 - whole], the same as CombBank
+        combReadOffsets[lane] = 1 + delay;
+        laneDelays[lane] = static_cast<float>(delay);
+      });
+
+      forEachIndex<NumAllPasses>([&](auto stage) {
+        auto delay = getDelayInSamples(Config::allPassDelayTimes[stage], sampleRate);
+        jassert(delay >= 1);
+
+        // The all-passes read v[n - D]
+        allPassReadOffsets[stage][static_cast<size_t>(channel)] =
+            delay + channel * stereoSpread;
+      });
+    }
+  }
+
+  void updateFeedback(bool shouldRamp) {
+    if (!feedbackCache.update({ decayTime, sampleRate }))
+      return;
+
+    // The same mapping and limit as CombBank
+    constexpr float maxLogFeedback = -0.07400058f;  // log2(0.95)
+    auto exponentPerSample = getDecayExponent(decayTime, sampleRate);
+
+    for (size_t lane = 0; lane < numLanes; ++lane) {
+      auto logGain = std::min(laneDelays[lane] * exponentPerSample, maxLogFeedback);
+      targetLogFeedback[lane] = logGain;
+      targetFeedback[lane] = Config::combSigns[lane % NumCombs] * fastExp2(logGain);
+    }
+
+    auto rampLength = static_cast<int>(feedbackRampTime * sampleRate);
+
+    if (!shouldRamp || rampLength < 1) {
+      finishFeedbackRamp();
+      return;
+    }
+
+    auto inverseRampLength = 1.0f / static_cast<float>(rampLength);
+
+    for (size_t lane = 0; lane < numLanes; ++lane) {
+      logFeedbackStep[lane] = (targetLogFeedback[lane] - logFeedback[lane]) * inverseRampLength;
+      feedbackRatio[lane] = fastExp2(logFeedbackStep[lane]);
+    }
+
+    rampSamplesRemaining = rampLength;
+  }
+
+  void advanceFeedbackRamp(int numSamples) noexcept {
+    auto numSteps = std::min(numSamples, rampSamplesRemaining);
+    rampSamplesRemaining -= numSteps;
+
+    if (rampSamplesRemaining == 0) {
+      finishFeedbackRamp();
+      return;
+    }
+
+    for (size_t lane = 0; lane < numLanes; ++lane) {
+      logFeedback[lane] += static_cast<float>(numSteps) * logFeedbackStep[lane];
+    }
+  }
+
+  void finishFeedbackRamp() noexcept {
+    feedback = targetFeedback;
+    logFeedback = targetLogFeedback;
+    rampSamplesRemaining = 0;
+  }
+
+  template <bool Ramp>
+  void processRange(const float* const* input, float* const* output,
+                    int startSample, int endSample) {
+    if (numChannels == 2) {
+      processChannels<Ramp, 2>(input, output, startSample, endSample);
+    } else {
+      processChannels<Ramp, 1>(input, output, startSample, endSample);
+    }
+  }
+
+  template <bool Ramp, int Channels>
+  void processChannels(const float* const* input, float* const* output,
+                       int startSample, int endSample) {
+    constexpr size_t lanes = static_cast<size_t>(NumCombs * Channels);
+    constexpr float combGain = 1.0f / static_cast<float>(NumCombs);
+    constexpr float allPassGain = Config::allPassFeedback;
+
+    // Local copies, so the compiler knows nothing in the loop writes to them
+    // and can keep them in registers
+    auto gains = feedback;
+    const auto ratios = feedbackRatio;
+    const auto combOffsets = combReadOffsets;
+    const auto stageOffsets = allPassReadOffsets;
+    const auto mask = static_cast<unsigned int>(combMask);
+    auto position = writePosition;
+
+    for (int i = startSample; i < endSample; ++i) {
+      // Every comb reads its delayed output and writes back the input plus
+      // that times its feedback, all lanes side by side
+      std::array<float, lanes> delayed;
+
+      for (size_t lane = 0; lane < lanes; ++lane) {
+        auto readRow = (position - static_cast<unsigned int>(combOffsets[lane])) & mask;
+        delayed[lane] = combRing[readRow * lanes + lane];
+      }
+
+      auto* row = combRing + (position & mask) * lanes;
+      std::array<float, Channels> sums {};
+
+      for (size_t channel = 0; channel < Channels; ++channel) {
+        auto sample = input[channel][i];
+
+        for (size_t comb = 0; comb < NumCombs; ++comb) {
+          auto lane = channel * NumCombs + comb;
+
+          if constexpr (Ramp) {
+            gains[lane] *= ratios[lane];
+          }
+
+          auto filtered = sample + gains[lane] * delayed[lane];
+          row[lane] = filtered;
+          sums[channel] += filtered;
+        }
+
+        sums[channel] *= combGain;
+      }
+
+      // The averaged combs go through each all-pass in turn
+      forEachIndex<NumAllPasses>([&](auto stage) {
+        auto stageMask = static_cast<unsigned int>(allPassMasks[stage]);
+        auto* ring = allPassRings[stage];
+        auto* stageRow = ring + (position & stageMask) * Channels;
+
+        for (size_t channel = 0; channel < Channels; ++channel) {
+          auto readRow = (position - static_cast<unsigned int>(stageOffsets[stage][channel])) &
+                         stageMask;
+          auto stageDelayed = ring[readRow * Channels + channel];
+          auto state = sums[channel] + allPassGain * stageDelayed;
+
+          stageRow[channel] = state;
+          sums[channel] = stageDelayed - allPassGain * state;
+        }
+      });
+
+      for (size_t channel = 0; channel < Channels; ++channel) {
+        output[channel][i] = sums[channel];
+      }
+
+      ++position;
+    }
+
+    writePosition = position;
+
+    if constexpr (Ramp) {
+      feedback = gains;
+    }
+  }
+
+  float sampleRate = 44100.0f;  // sample rate in Hz
+  float decayTime = 1.0f;       // decay in seconds the feedback is set from
+  int numChannels = 0;          // channels the rings were set up for
+  int stereoSpread = 0;         // extra delay of the right channel in samples
+
+  // Every ring is written at the same position, wrapped by its own mask
+  unsigned int writePosition = 0;
+
+  float* combRing = nullptr;  // rows of NumCombs * numChannels lanes
+  int combMask = 0;           // rows in the ring - 1
+  std::array<int, numLanes> combReadOffsets {};  // rows behind the write
+  LaneFloats laneDelays {};                      // in samples
+
+  std::array<float*, NumAllPasses> allPassRings {};
+  std::array<int, NumAllPasses> allPassMasks {};
+  std::array<std::array<int, maxNumChannels>, NumAllPasses> allPassReadOffsets {};
+
+  // The feedback of each lane, and its ramp
+  LaneFloats feedback {};
+  LaneFloats feedbackRatio {};
+  LaneFloats targetFeedback {};
+  LaneFloats logFeedback {};
+  LaneFloats targetLogFeedback {};
+  LaneFloats logFeedbackStep {};
+  int rampSamplesRemaining = 0;
+  CoefficientCache<2> feedbackCache;  // from the decay and the sample rate
+};
+
+//==============================================================================
+// Configurations
+
+// The network Reverb builds out of CombBank and AllPassChain
+struct ClassicSchroederConfig {
+  static constexpr std::array<float, 4> combDelayTimes { 30.1f, 34.2f, 39.1f, 45.1f };
+  static constexpr std::array<float, 4> combSigns { -1.0f, 1.0f, -1.0f, 1.0f };
+  static constexpr std::array<float, 2> allPassDelayTimes { 1.2f, 3.6f };
+  static constexpr float allPassFeedback = 0.5f;
+};
+
+// Freeverb's tunings, converted from samples at 44.1 kHz to ms
+struct FreeverbConfig {
+  static constexpr std::array<float, 8> combDelayTimes {
+      25.31f, 26.94f, 28.96f, 30.75f, 32.24f, 33.81f, 35.31f, 36.67f };
+  static constexpr std::array<float, 8> combSigns {
+      1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+  static constexpr std::array<float, 4> allPassDelayTimes { 12.61f, 10.0f, 7.73f, 5.10f };
+  static constexpr float allPassFeedback = 0.5f;
+};
+
+// Freeverb's tunings with four longer combs and two shorter all-passes
+struct LargeSchroederConfig {
+  static constexpr std::array<float, 12> combDelayTimes {
+      25.31f, 26.94f, 28.96f, 30.75f, 32.24f, 33.81f,
+      35.31f, 36.67f, 39.23f, 41.71f, 44.29f, 47.13f };
+  static constexpr std::array<float, 12> combSigns {
+      1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+  static constexpr std::array<float, 6> allPassDelayTimes {
+      12.61f, 10.0f, 7.73f, 5.10f, 3.6f, 1.7f };
+  static constexpr float allPassFeedback = 0.5f;
+};
+
+using ClassicSchroeder = SchroederNetwork<4, 2, ClassicSchroederConfig>;
+using Freeverb = SchroederNetwork<8, 4, FreeverbConfig>;
+using LargeSchroeder = SchroederNetwork<12, 6, LargeSchroederConfig>;
@@ -0,0 +1,51 @@
+#include "Benchmark.h"
+#include "Reverb.h"
+#include <array>
+#include <cstdio>
+
+// A stereo instance against one in send mode, which runs the networks once
+// on the channels summed to mono, on each quality tier. Both run fully wet,
+// as on an aux send, and are timed in the same comparison
+namespace benchmark {
+void runSend() {
+  constexpr std::array<Reverb::Quality, 3> qualities { Reverb::Quality::eco,
+                                                       Reverb::Quality::standard,
+                                                       Reverb::Quality::high };
+  constexpr std::array<const char*, 3> qualityNames { "eco", "standard", "high" };
+
+  juce::AudioBuffer<float> input(2, blockSize);
+  fillWithNoise(input);
+
+  std::array<std::array<Reverb, 2>, qualities.size()> reverbs;
+  std::array<std::array<juce::AudioBuffer<float>, 2>, qualities.size()> buffers;
+  std::vector<std::function<void()>> candidates;
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    for (size_t send = 0; send < 2; ++send) {
+      auto& reverb = reverbs[q][send];
+      auto& buffer = buffers[q][send];
+
+      reverb.setSendModeEnabled(send == 1);
+      reverb.prepare(sampleRate, blockSize, 2);
+      reverb.setEngine(Reverb::Engine::schroeder);
+      reverb.setQuality(qualities[q]);
+      reverb.setMix(1.0f);
+      buffer.setSize(2, blockSize);
+
+      candidates.push_back([&reverb, &buffer, &input] {
+        copy(input, buffer);
+        reverb.process(buffer);
+      });
+    }
+  }
+
+  auto times = compare(candidates, blockSize);
+
+  std::printf("ns per stereo frame, fully wet, %d sample blocks\n", blockSize);
+  std::printf("%-10s %8s %8s\n", "quality", "stereo", "send");
+
+  for (size_t q = 0; q < qualities.size(); ++q) {
+    std::printf("%-10s %8.1f %8.1f\n", qualityNames[q], times[q * 2], times[q * 2 + 1]);
+  }
+}
+}
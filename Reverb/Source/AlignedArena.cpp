@@ -0,0 +1,71 @@
+#include "AlignedArena.h"
+#include <cstring>
+#include <new>
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+#endif
+
+namespace {
+// Pins the pages of a range in physical memory so they can't be swapped out
+// under the audio thread. This is only a hint: it fails quietly when the
+// process has hit its limit of locked memory
+bool lockPages(void* memory, size_t numBytes) {
+#if JUCE_WINDOWS
+  return VirtualLock(memory, numBytes) != 0;
+#else
+  return mlock(memory, numBytes) == 0;
+#endif
+}
+
+void unlockPages(void* memory, size_t numBytes) {
+#if JUCE_WINDOWS
+  VirtualUnlock(memory, numBytes);
+#else
+  munlock(memory, numBytes);
+#endif
+}
+}
+
+AlignedArena::~AlignedArena() {
+  release();
+}
+
+void AlignedArena::reset(size_t numBytes) {
+  release();
+
+  if (numBytes == 0)
+    return;
+
+  sizeInBytes = (numBytes + alignment - 1) & ~(alignment - 1);
+  block = static_cast<char*>(
+      ::operator new(sizeInBytes, std::align_val_t(alignment)));
+
+  // Writing the whole block faults every page in now rather than
+  // the first time the audio thread reaches it
+  std::memset(block, 0, sizeInBytes);
+  locked = lockPages(block, sizeInBytes);
+}
+
+void AlignedArena::release() noexcept {
+  if (block == nullptr)
+    return;
+
+  if (locked)
+    unlockPages(block, sizeInBytes);
+
+  ::operator delete(block, std::align_val_t(alignment));
+
+  block = nullptr;
+  sizeInBytes = 0;
+  usedBytes = 0;
+  locked = false;
+}
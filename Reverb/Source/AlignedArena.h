@@ -0,0 +1,64 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <cstddef>
+
+/**
+ * One 64-byte aligned block of memory that an effect carves all of its
+ * delay lines and buffers out of.
+ *
+ * The block is sized and allocated once in prepare(), and every allocation
+ * out of it is rounded up to a whole cache line, so no two users of the
+ * arena ever share one. The pages are written to (and locked in memory where
+ * the OS allows it) as soon as the block is allocated, so the audio thread
+ * never takes the page fault of touching one for the first time.
+ *
+ * Callers add up getAllocationSize() for everything they are going to take
+ * from the arena, pass the total to reset(), and then take their memory with
+ * allocate() in the same order.
+ */
+class AlignedArena {
+public:
+  static constexpr size_t alignment = 64;
+
+  AlignedArena() = default;
+  ~AlignedArena();
+
+  // Frees the current block and allocates a zeroed one of at least numBytes.
+  // Every pointer handed out before is invalid afterwards
+  void reset(size_t numBytes);
+
+  // Takes count objects of type T from the block. The memory is zeroed but
+  // no constructors are run, so T should be a float or a pointer
+  template <typename T>
+  T* allocate(size_t count) noexcept {
+    auto numBytes = getAllocationSize<T>(count);
+
+    // reset() was given less than the callers went on to ask for
+    jassert(usedBytes + numBytes <= sizeInBytes);
+
+    auto* memory = reinterpret_cast<T*>(block + usedBytes);
+    usedBytes += numBytes;
+    return memory;
+  }
+
+  // The number of bytes allocate<T>(count) takes from the block
+  template <typename T>
+  static constexpr size_t getAllocationSize(size_t count) noexcept {
+    return (count * sizeof(T) + alignment - 1) & ~(alignment - 1);
+  }
+
+  size_t getSize() const noexcept { return sizeInBytes; }
+  size_t getNumBytesUsed() const noexcept { return usedBytes; }
+  bool isLocked() const noexcept { return locked; }
+
+private:
+  void release() noexcept;
+
+  char* block = nullptr;
+  size_t sizeInBytes = 0;
+  size_t usedBytes = 0;
+  bool locked = false;  // whether the pages are pinned in physical memory
+
+  JUCE_DECLARE_NON_COPYABLE(AlignedArena)
+};
@@ -0,0 +1,381 @@
+#include "AllPassChain.h"
+#include <algorithm>
+#include <cmath>
+
+void AllPassChain::setNumStages(int numberOfStages) {
+  jassert(numberOfStages > 0 && numberOfStages <= maxNumStages);
+  numStages = numberOfStages;
+  updateDelays();
+}
+
+void AllPassChain::setDelayTime(int stage, float value) {
+  jassert(stage >= 0 && stage < maxNumStages);
+  delayTimes[static_cast<size_t>(stage)] = value;
+  updateDelays();
+}
+
+void AllPassChain::setSampleRate(float value) {
+  sampleRate = value;
+  updateDelays();
+}
+
+void AllPassChain::setFeedback(int stage, float value) {
+  jassert(stage >= 0 && stage < maxNumStages);
+
+  // A gain of 1 or more would never decay
+  feedback[static_cast<size_t>(stage)] = std::clamp(value, -0.9f, 0.9f);
+}
+
+void AllPassChain::setTopology(Topology newTopology) {
+  topology = newTopology;
+}
+
+void AllPassChain::setStereoSpread(int samples) {
+  jassert(samples >= 0 && samples <= maxStereoSpread);
+  stereoSpread = samples;
+  updateDelays();
+}
+
+void AllPassChain::updateDelays() {
+  for (size_t stage = 0; stage < maxNumStages; ++stage) {
+    auto delayTimeInSamples = static_cast<int>(
+        std::round((delayTimes[stage] / 1000.0f) * sampleRate));
+
+    // The right channel is spread out from the left
+    for (size_t channel = 0; channel < maxNumChannels; ++channel) {
+      auto delay = channel > 0 ? delayTimeInSamples + stereoSpread
+                               : delayTimeInSamples;
+
+      readDelays[stage][channel] = delay - 1;
+    }
+  }
+}
+
+int AllPassChain::getRequiredRingSize(int stage) const {
+  // The longest read is D - 1 rows behind the row being written,
+  // and the right channel needs room for the most spread
+  auto longestReadDelay = readDelays[static_cast<size_t>(stage)][0] + maxStereoSpread;
+  return juce::nextPowerOfTwo(longestReadDelay + 2);
+}
+
+size_t AllPassChain::getMemorySize(int numberOfChannels) const {
+  size_t numFloats = 0;
+
+  for (int stage = 0; stage < numStages; ++stage) {
+    numFloats += static_cast<size_t>(getRequiredRingSize(stage) * numberOfChannels);
+  }
+
+  // All of the rings share one allocation
+  return AlignedArena::getAllocationSize<float>(numFloats);
+}
+
+void AllPassChain::prepare(float samplingRate, int numberOfChannels,
+                           AlignedArena& arena) {
+  jassert(numStages > 0);
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  setSampleRate(samplingRate);
+  numChannels = numberOfChannels;
+
+  size_t numFloats = 0;
+
+  for (int stage = 0; stage < numStages; ++stage) {
+    jassert(readDelays[static_cast<size_t>(stage)][0] >= 0);
+    numFloats += static_cast<size_t>(getRequiredRingSize(stage) * numChannels);
+  }
+
+  // Lay the rings out back to back. The arena hands them out already cleared
+  auto* memory = arena.allocate<float>(numFloats);
+
+  for (int stage = 0; stage < numStages; ++stage) {
+    auto ringSize = getRequiredRingSize(stage);
+
+    rings[static_cast<size_t>(stage)] = memory;
+    ringMasks[static_cast<size_t>(stage)] = ringSize - 1;
+    memory += ringSize * numChannels;
+  }
+
+  writePositions.fill(0);
+}
+
+void AllPassChain::reset() noexcept {
+  for (int stage = 0; stage < numStages; ++stage) {
+    auto* ring = rings[static_cast<size_t>(stage)];
+    std::fill(ring, ring + (ringMasks[static_cast<size_t>(stage)] + 1) * numChannels,
+              0.0f);
+  }
+
+  writePositions.fill(0);
+}
+
+float AllPassChain::getPeakLevel() const noexcept {
+  float peak = 0.0f;
+
+  for (int stage = 0; stage < numStages; ++stage) {
+    auto range = juce::FloatVectorOperations::findMinAndMax(
+        rings[static_cast<size_t>(stage)],
+        (ringMasks[static_cast<size_t>(stage)] + 1) * numChannels);
+    peak = std::max({ peak, -range.getStart(), range.getEnd() });
+  }
+
+  return peak;
+}
+
+void AllPassChain::process(juce::AudioBuffer<float>& buffer) {
+  int numSamples = buffer.getNumSamples();
+  int numBufferChannels = buffer.getNumChannels();
+  jassert(numBufferChannels <= numChannels);
+
+  // Both channels of a stereo buffer advance together in one loop
+  if (numBufferChannels == 2) {
+    auto* left = buffer.getWritePointer(0);
+    auto* right = buffer.getWritePointer(1);
+
+    if (topology == Topology::nested) {
+      processStereo<Topology::nested>(left, right, numSamples);
+    } else {
+      processStereo<Topology::series>(left, right, numSamples);
+    }
+
+    return;
+  }
+
+  for (int channel = 0; channel < numBufferChannels; ++channel) {
+    auto* channelData = buffer.getWritePointer(channel);
+
+    if (topology == Topology::nested) {
+      processChannel<Topology::nested>(channel, channelData, numSamples);
+    } else {
+      processChannel<Topology::series>(channel, channelData, numSamples);
+    }
+  }
+}
+
+template <AllPassChain::Topology ChainTopology>
+void AllPassChain::processStereo(float* left, float* right, int numSamples) {
+  // Left and right don't depend on each other, so running them side by side
+  // through each stage lets the CPU overlap the two channels' feedback loops
+  jassert(numChannels == 2 && writePositions[0] == writePositions[1]);
+  auto writePosition = writePositions[0];
+
+  // Each stage reads v[n - D] of both channels, D - 1 rows behind the
+  // newest row, and then writes both channels' v[n] into the next row
+  auto readStage = [this, &writePosition](size_t stage, float& delayedLeft,
+                                          float& delayedRight) {
+    auto mask = static_cast<unsigned int>(ringMasks[stage]);
+    auto leftRow = (writePosition - 1u - static_cast<unsigned int>(readDelays[stage][0])) & mask;
+    auto rightRow = (writePosition - 1u - static_cast<unsigned int>(readDelays[stage][1])) & mask;
+
+    delayedLeft = rings[stage][leftRow * 2];
+    delayedRight = rings[stage][rightRow * 2 + 1];
+  };
+
+  auto writeStage = [this, &writePosition](size_t stage, float leftState,
+                                           float rightState) {
+    auto mask = static_cast<unsigned int>(ringMasks[stage]);
+    auto* row = rings[stage] + (writePosition & mask) * 2;
+
+    row[0] = leftState;
+    row[1] = rightState;
+  };
+
+  const auto stages = static_cast<size_t>(numStages);
+
+  for (int i = 0; i < numSamples; ++i) {
+    if constexpr (ChainTopology == Topology::series) {
+      auto leftSample = left[i];
+      auto rightSample = right[i];
+
+      for (size_t stage = 0; stage < stages; ++stage) {
+        float delayedLeft, delayedRight;
+        readStage(stage, delayedLeft, delayedRight);
+
+        auto gain = feedback[stage];
+        auto leftState = leftSample + gain * delayedLeft;
+        auto rightState = rightSample + gain * delayedRight;
+        writeStage(stage, leftState, rightState);
+
+        leftSample = delayedLeft - gain * leftState;
+        rightSample = delayedRight - gain * rightState;
+      }
+
+      left[i] = leftSample;
+      right[i] = rightSample;
+    } else {
+      std::array<float, maxNumStages> delayedLefts, delayedRights;
+
+      for (size_t stage = 0; stage < stages; ++stage) {
+        readStage(stage, delayedLefts[stage], delayedRights[stage]);
+      }
+
+      // Work outwards from the innermost stage, as in filterSample()
+      auto leftOutput = delayedLefts[stages - 1];
+      auto rightOutput = delayedRights[stages - 1];
+
+      for (auto stage = stages; stage-- > 0;) {
+        auto leftInput = stage == 0 ? left[i] : delayedLefts[stage - 1];
+        auto rightInput = stage == 0 ? right[i] : delayedRights[stage - 1];
+
+        auto gain = feedback[stage];
+        auto leftState = leftInput + gain * leftOutput;
+        auto rightState = rightInput + gain * rightOutput;
+        writeStage(stage, leftState, rightState);
+
+        leftOutput -= gain * leftState;
+        rightOutput -= gain * rightState;
+      }
+
+      left[i] = leftOutput;
+      right[i] = rightOutput;
+    }
+
+    ++writePosition;
+  }
+
+  writePositions.fill(writePosition);
+}
+
+template <AllPassChain::Topology ChainTopology>
+void AllPassChain::processChannel(int channel, float* samples, int numSamples) {
+  // A sample at a time, a lone channel is one long chain of dependent
+  // multiplies. But no stage reads a state less than D samples old, so a
+  // run of up to D samples only depends on states written before it, and
+  // can be worked out a stage at a time across the whole run, which
+  // vectorises. The sums are the same as filterSample()'s
+  auto c = static_cast<size_t>(channel);
+  auto writePosition = writePositions[c];
+  const auto stages = static_cast<size_t>(numStages);
+
+  auto runLength = maxRunLength;
+
+  for (size_t stage = 0; stage < stages; ++stage) {
+    runLength = std::min(runLength, readDelays[stage][c] + 1);
+  }
+
+  std::array<std::array<float, maxRunLength>, maxNumStages> delayedStates;
+  std::array<std::array<float, maxRunLength>, maxNumStages> states;
+
+  for (int start = 0; start < numSamples; start += runLength) {
+    auto length = std::min(runLength, numSamples - start);
+    auto* run = samples + start;
+
+    for (size_t stage = 0; stage < stages; ++stage) {
+      auto mask = static_cast<unsigned int>(ringMasks[stage]);
+      auto readPosition = writePosition - 1u - static_cast<unsigned int>(readDelays[stage][c]);
+      auto& delayed = delayedStates[stage];
+
+      for (int i = 0; i < length; ++i) {
+        auto row = (readPosition + static_cast<unsigned int>(i)) & mask;
+        delayed[static_cast<size_t>(i)] = rings[stage][static_cast<int>(row) * numChannels + channel];
+      }
+    }
+
+    if constexpr (ChainTopology == Topology::series) {
+      for (size_t stage = 0; stage < stages; ++stage) {
+        const auto gain = feedback[stage];
+        const auto& delayed = delayedStates[stage];
+        auto& state = states[stage];
+
+        for (int i = 0; i < length; ++i) {
+          auto n = static_cast<size_t>(i);
+          state[n] = run[i] + gain * delayed[n];
+          run[i] = delayed[n] - gain * state[n];
+        }
+      }
+    } else {
+      // Outwards from the innermost stage, as in filterSample()
+      std::array<float, maxRunLength> delayOutput;
+      std::copy(delayedStates[stages - 1].begin(), delayedStates[stages - 1].begin() + length,
+                delayOutput.begin());
+
+      for (auto stage = stages; stage-- > 0;) {
+        const auto gain = feedback[stage];
+        const auto* stageInput = stage == 0 ? run : delayedStates[stage - 1].data();
+        auto& state = states[stage];
+
+        for (int i = 0; i < length; ++i) {
+          auto n = static_cast<size_t>(i);
+          state[n] = stageInput[i] + gain * delayOutput[n];
+          delayOutput[n] -= gain * state[n];
+        }
+      }
+
+      std::copy(delayOutput.begin(), delayOutput.begin() + length, run);
+    }
+
+    for (size_t stage = 0; stage < stages; ++stage) {
+      auto mask = static_cast<unsigned int>(ringMasks[stage]);
+
+      for (int i = 0; i < length; ++i) {
+        auto row = (writePosition + static_cast<unsigned int>(i)) & mask;
+        rings[stage][static_cast<int>(row) * numChannels + channel] = states[stage][static_cast<size_t>(i)];
+      }
+    }
+
+    writePosition += static_cast<unsigned int>(length);
+  }
+
+  writePositions[c] = writePosition;
+}
+
+float AllPassChain::processSample(int channel, float inputSample) {
+  return topology == Topology::nested
+             ? filterSample<Topology::nested>(channel, inputSample)
+             : filterSample<Topology::series>(channel, inputSample);
+}
+
+template <AllPassChain::Topology ChainTopology>
+float AllPassChain::filterSample(int channel, float inputSample) {
+  auto c = static_cast<size_t>(channel);
+  auto writePosition = writePositions[c];
+
+  // Stage s's state for this channel at a given point in time
+  auto stateAt = [this, channel](size_t stage, unsigned int position) -> float& {
+    auto row = static_cast<int>(position) & ringMasks[stage];
+    return rings[stage][row * numChannels + channel];
+  };
+
+  // Each stage reads v[n - D], which is D - 1 rows behind the newest one
+  auto delayedStateOf = [&](size_t stage) {
+    auto readDelay = static_cast<unsigned int>(readDelays[stage][c]);
+    return stateAt(stage, writePosition - 1u - readDelay);
+  };
+
+  if constexpr (ChainTopology == Topology::series) {
+    auto sample = inputSample;
+
+    for (size_t stage = 0; stage < static_cast<size_t>(numStages); ++stage) {
+      auto delayedState = delayedStateOf(stage);
+      auto state = sample + feedback[stage] * delayedState;
+
+      stateAt(stage, writePosition) = state;
+      sample = delayedState - feedback[stage] * state;
+    }
+
+    writePositions[c] = writePosition + 1u;
+    return sample;
+  } else {
+    // Every stage's v[n - D] is already known, so read them all first
+    std::array<float, maxNumStages> delayedStates;
+
+    for (size_t stage = 0; stage < static_cast<size_t>(numStages); ++stage) {
+      delayedStates[stage] = delayedStateOf(stage);
+    }
+
+    // Then work outwards from the innermost stage. Each stage filters the
+    // delayed state of the one around it, and its output stands in for
+    // that stage's delay
+    auto delayOutput = delayedStates[static_cast<size_t>(numStages - 1)];
+
+    for (auto stage = static_cast<size_t>(numStages); stage-- > 0;) {
+      auto stageInput = stage == 0 ? inputSample : delayedStates[stage - 1];
+      auto state = stageInput + feedback[stage] * delayOutput;
+
+      stateAt(stage, writePosition) = state;
+      delayOutput -= feedback[stage] * state;
+    }
+
+    writePositions[c] = writePosition + 1u;
+    return delayOutput;
+  }
+}
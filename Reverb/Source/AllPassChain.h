@@ -0,0 +1,104 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AlignedArena.h"
+#include <array>
+
+/**
+ * A diffusion stage made of several all-pass filters run in one loop.
+ *
+ * The all-passes are either in series, each filtering the output of the one
+ * before it, or nested, with each one sitting inside the delay of the one
+ * before it as in Gardner's nested all-pass. Every stage is a Schroeder
+ * all-pass in its canonical form, with one delay line per channel holding
+ * its state:
+ *   v[n] = x[n] + g * v[n - D]
+ *   y[n] = v[n - D] - g * v[n]
+ *
+ * The delay lines of every stage sit back to back in a single allocation
+ * from an AlignedArena, with the channels of each stage interleaved, so one
+ * frame of the chain only touches a handful of nearby cache lines. Delays
+ * are rounded to whole samples.
+ */
+class AllPassChain {
+public:
+  static constexpr int maxNumStages = 8;
+  static constexpr int maxNumChannels = 2;
+  static constexpr int maxStereoSpread = 256;  // in samples
+
+  enum class Topology {
+    series,  // each stage filters the output of the last
+    nested   // each stage replaces the delay of the last
+  };
+
+  // The number of stages, delay times and sample rate decide how much
+  // memory the chain needs, so they have to be set before prepare()
+  void setNumStages(int numberOfStages);
+  void setDelayTime(int stage, float value);  // in ms
+  void setSampleRate(float value);
+
+  void setFeedback(int stage, float value);
+  void setTopology(Topology newTopology);
+
+  // Lengthens every delay of the right channel by this many samples, so the
+  // two channels decorrelate. The delay lines always have room for
+  // maxStereoSpread, so this can be changed without preparing again
+  void setStereoSpread(int samples);
+
+  // Bytes prepare() takes from the arena for the current stages
+  size_t getMemorySize(int numChannels) const;
+
+  // The delay lines are taken from the arena, which must outlive the chain.
+  // Every delay must be at least one sample
+  void prepare(float samplingRate, int numChannels, AlignedArena& arena);
+  void reset() noexcept;
+
+  // The largest magnitude of anything in the stages' delay lines
+  float getPeakLevel() const noexcept;
+
+  // Stereo buffers have both channels filtered together in one loop, and
+  // any other channel on its own a run of samples at a time
+  void process(juce::AudioBuffer<float>& buffer);
+
+  // Runs a single sample of one channel through the whole chain
+  float processSample(int channel, float inputSample);
+
+  int getNumStages() const noexcept { return numStages; }
+  Topology getTopology() const noexcept { return topology; }
+
+private:
+  void updateDelays();
+  int getRequiredRingSize(int stage) const;
+
+  template <Topology ChainTopology>
+  float filterSample(int channel, float inputSample);
+
+  template <Topology ChainTopology>
+  void processStereo(float* left, float* right, int numSamples);
+
+  template <Topology ChainTopology>
+  void processChannel(int channel, float* samples, int numSamples);
+
+  // The most samples processChannel() works out a stage at a time
+  static constexpr int maxRunLength = 64;
+
+  float sampleRate = 44100.0f;  // sample rate in Hz
+  int numStages = 0;
+  int numChannels = 0;          // channels the delay lines were set up for
+  int stereoSpread = 0;         // extra delay of the right channel in samples
+  Topology topology = Topology::series;
+
+  std::array<float, maxNumStages> delayTimes {};  // in ms
+  std::array<float, maxNumStages> feedback {};    // gain of each stage
+
+  // Each stage's ring holds its state v for every channel, one row of
+  // numChannels samples per point in time
+  std::array<float*, maxNumStages> rings {};
+  std::array<int, maxNumStages> ringMasks {};  // rows in each ring - 1
+
+  // How far behind the newest row each stage reads v[n - D] from, i.e. D - 1
+  std::array<std::array<int, maxNumChannels>, maxNumStages> readDelays {};
+
+  // The row each channel writes next, wrapped by each stage's own mask
+  std::array<unsigned int, maxNumChannels> writePositions {};
+};
@@ -0,0 +1,10 @@
+#include "Coefficients.h"
+
+void computeDecayGains(const float* delays, float* gains, int numDelays,
+                       float decay, float sampleRate) noexcept {
+  const auto exponentPerSample = getDecayExponent(decay, sampleRate);
+
+  for (int i = 0; i < numDelays; ++i) {
+    gains[i] = fastExp2(delays[i] * exponentPerSample);
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Everything the reverb derives its coefficients from its parameters with.
+ *
+ * The processor passes every parameter on at the start of every block,
+ * whether it has moved or not, so anything worked out from them (the
+ * feedback gains now, and filter and modulation coefficients later) is kept
+ * in a CoefficientCache and only worked out again when one of its inputs
+ * actually changes.
+ *
+ * Most of those coefficients are exponentials, so they are computed with
+ * fastExp2(), which has no branches or library calls and vectorises in a
+ * loop. Over the range the reverb uses it is within 3e-7 of std::exp2,
+ * i.e. a few ulp.
+ */
+
+// 2^x for x in [-126, 126]. x is split into a whole part, which goes
+// straight into the exponent bits, and a fraction in [-0.5, 0.5], which a
+// 5th order polynomial fitted for relative error covers. x isn't clamped,
+// as the comparisons would stop the loops calling this from vectorising.
+// The rounding relies on strict float semantics, so no -ffast-math
+inline float fastExp2(float x) noexcept {
+  jassert(x >= -126.0f && x <= 126.0f);
+
+  // Adding and subtracting 1.5 * 2^23 rounds to the nearest whole number
+  constexpr float roundingConstant = 12582912.0f;
+  auto whole = (x + roundingConstant) - roundingConstant;
+  auto fraction = x - whole;
+
+  auto polynomial =
+      1.000000071e+00f +
+      fraction * (6.931469492e-01f +
+      fraction * (2.402212175e-01f +
+      fraction * (5.550742616e-02f +
+      fraction * (9.675459746e-03f +
+      fraction * 1.326697037e-03f))));
+
+  auto exponentBits = static_cast<uint32_t>(static_cast<int32_t>(whole) + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &exponentBits, sizeof(scale));
+
+  return polynomial * scale;
+}
+
+// log2 of the gain that makes one sample of delay decay by 60 dB in decay
+// seconds. A delay of d samples gets 2^(d * getDecayExponent())
+inline float getDecayExponent(float decay, float sampleRate) noexcept {
+  jassert(decay > 0.0f && sampleRate > 0.0f);
+
+  // 10^(-3 / (T fs)) = 2^(-3 log2(10) / (T fs))
+  return -3.0f * 3.321928095f / (decay * sampleRate);
+}
+
+// Writes the gain that makes each delay decay by 60 dB in decay seconds,
+// 10^(-3 * delay / (decay * sampleRate)), for all of the delays at once
+//  @param delays are the delays in samples
+void computeDecayGains(const float* delays, float* gains, int numDelays,
+                       float decay, float sampleRate) noexcept;
+
+/**
+ * Remembers the inputs a set of coefficients was last worked out from.
+ */
+template <int NumInputs>
+class CoefficientCache {
+public:
+  using Inputs = std::array<float, NumInputs>;
+
+  // Stores the inputs and returns whether the coefficients need working out
+  // again, i.e. whether any input changed or the cache was invalidated
+  bool update(const Inputs& newInputs) noexcept {
+    if (valid && newInputs == inputs)
+      return false;
+
+    inputs = newInputs;
+    valid = true;
+    return true;
+  }
+
+  // Forces the next update() to return true, for when something the inputs
+  // don't cover has changed
+  void invalidate() noexcept { valid = false; }
+
+private:
+  Inputs inputs {};
+  bool valid = false;
+};
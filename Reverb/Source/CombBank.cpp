@@ -0,0 +1,410 @@
+#include "CombBank.h"
+#include "CombBankKernels.h"
+#include <cmath>
+
+namespace {
+// Writes the averaged comb output straight through
+struct PassThrough {
+  float operator()(int, int, float, float wetSample) const noexcept {
+    return wetSample;
+  }
+};
+}
+
+void CombBank::setDelayTime(int comb, float value) {
+  jassert(comb >= 0 && comb < maxNumCombs);
+  delayTimes[static_cast<size_t>(comb)] = value;
+  updateLanes();
+}
+
+void CombBank::setPhaseFlipped(int comb, bool flipped) {
+  jassert(comb >= 0 && comb < maxNumCombs);
+  phaseFlipped[static_cast<size_t>(comb)] = flipped;
+  updateLanes();
+}
+
+/**
+ * Sets the feedback of every comb based on a given decay
+ *  @param decay is the desired decay of the filters in seconds
+ *  @param shouldRamp is whether to ramp to it or jump straight there
+ */
+void CombBank::setFeedback(float decay, bool shouldRamp) {
+  decayTime = decay;
+  updateFeedback(shouldRamp);
+}
+
+void CombBank::setSampleRate(float value) {
+  sampleRate = value;
+  updateLanes();
+  updateDamping();
+}
+
+void CombBank::setDelayScale(float scale) {
+  jassert(scale > 0.0f && scale <= maxDelayScale);
+  targetDelayScale = std::min(scale, maxDelayScale);
+
+  // Before the ring exists there is no tail to fade from. Afterwards
+  // process() starts the crossfade, so a run of changes within one block
+  // only fades once
+  if (ring == nullptr) {
+    delayScale = targetDelayScale;
+    updateLanes();
+  }
+}
+
+void CombBank::setDamping(float amount) {
+  jassert(amount >= 0.0f && amount <= 1.0f);
+  damping = juce::jlimit(0.0f, 1.0f, amount);
+  updateDamping();
+}
+
+void CombBank::setInterpolated(bool shouldInterpolate) {
+  interpolated = shouldInterpolate;
+  updateLanes();
+}
+
+size_t CombBank::getMemorySize(int numberOfCombs,
+                               int numberOfChannels) const {
+  auto numFloats = static_cast<size_t>(getNumRows(numberOfCombs)) *
+                   static_cast<size_t>(getNumLanes(numberOfCombs, numberOfChannels));
+
+  return AlignedArena::getAllocationSize<float>(numFloats);
+}
+
+void CombBank::setStereoSpread(int samples) {
+  jassert(samples >= 0 && samples <= maxStereoSpread);
+  stereoSpread = samples;
+  updateLanes();
+}
+
+void CombBank::prepare(float samplingRate, int numberOfCombs,
+                       int numberOfChannels, AlignedArena& arena) {
+  jassert(numberOfCombs > 0 && numberOfCombs <= maxNumCombs);
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  sampleRate = samplingRate;
+  numCombs = numberOfCombs;
+  numChannels = numberOfChannels;
+
+  // Round the combs up to a whole number of SIMD registers per channel
+  combLanes = getCombLanes(numCombs, numChannels);
+  numLanes = combLanes * numChannels;
+
+  laneShift = 0;
+  while ((1 << laneShift) < numLanes)
+    ++laneShift;
+
+  // The arena hands the ring out already cleared, so any scale waiting
+  // for a crossfade can be jumped to
+  auto numRows = getNumRows(numCombs);
+  ring = arena.allocate<float>(static_cast<size_t>(numRows * numLanes));
+  ringMask = numRows - 1;
+  writeRow = 0;
+  crossfadeSamplesRemaining = 0;
+  delayScale = targetDelayScale;
+  dampingState.fill(0.0f);
+
+  updateLanes();
+  updateDamping();
+
+  // Use the fastest kernel that fits this many lanes
+  kernel = getBestAvailableKernel();
+  while (!isKernelUsable(kernel, numLanes))
+    kernel = static_cast<Kernel>(static_cast<int>(kernel) - 1);
+}
+
+void CombBank::reset() noexcept {
+  std::fill(ring, ring + (ringMask + 1) * numLanes, 0.0f);
+  dampingState.fill(0.0f);
+  writeRow = 0;
+
+  // With nothing left in the ring a new scale can be jumped to
+  crossfadeSamplesRemaining = 0;
+  delayScale = targetDelayScale;
+  updateLanes();
+
+  finishFeedbackRamp();
+}
+
+float CombBank::getPeakLevel() const noexcept {
+  auto range = juce::FloatVectorOperations::findMinAndMax(ring, (ringMask + 1) * numLanes);
+  return std::max(-range.getStart(), range.getEnd());
+}
+
+void CombBank::process(const juce::AudioBuffer<float>& input,
+                       juce::AudioBuffer<float>& output) {
+  PassThrough passThrough;
+  process(input, output, passThrough);
+}
+
+void CombBank::setKernel(Kernel newKernel) {
+  if (!isKernelUsable(newKernel, numLanes))
+    return;
+
+  kernel = newKernel;
+}
+
+CombBank::Kernel CombBank::getBestAvailableKernel() {
+  // cpuid is only asked once
+  static const Kernel bestKernel = [] {
+#if JUCE_INTEL
+    if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+      return Kernel::avx2;
+
+    if (juce::SystemStats::hasSSE2())
+      return Kernel::sse2;
+#endif
+    return Kernel::scalar;
+  }();
+
+  return bestKernel;
+}
+
+bool CombBank::isKernelUsable(Kernel kernelToCheck, int numberOfLanes) {
+  if (static_cast<int>(kernelToCheck) >
+      static_cast<int>(getBestAvailableKernel()))
+    return false;
+
+  switch (kernelToCheck) {
+    case Kernel::sse2:   return numberOfLanes % 4 == 0;
+    case Kernel::avx2:   return numberOfLanes % 8 == 0;
+    case Kernel::scalar:
+    default:             return true;
+  }
+}
+
+int CombBank::getCombLanes(int numberOfCombs, int numberOfChannels) {
+  if (numberOfCombs > 4)
+    return 8;
+
+  // Four mono combs would only fill half an AVX2 register and drop to the
+  // SSE2 kernel, which is slower than running four padding lanes alongside
+  if (numberOfChannels == 1 && getBestAvailableKernel() >= Kernel::avx2)
+    return 8;
+
+  return 4;
+}
+
+int CombBank::getNumLanes(int numberOfCombs, int numberOfChannels) {
+  return getCombLanes(numberOfCombs, numberOfChannels) * numberOfChannels;
+}
+
+int CombBank::getNumRows(int numberOfCombs) const {
+  // Size the ring for the longest delay at the largest scale with the most
+  // spread and modulation, plus the extra sample that interpolation reads
+  // past it
+  float longestDelay = 0.0f;
+  for (int comb = 0; comb < numberOfCombs; ++comb) {
+    longestDelay = std::max(longestDelay, delayTimes[static_cast<size_t>(comb)]);
+  }
+
+  longestDelay *= maxDelayScale;
+
+  auto longestDelayInSamples = (longestDelay / 1000.0f) * sampleRate;
+  jassert(longestDelayInSamples > 0.0f);
+
+  longestDelayInSamples += static_cast<float>(maxStereoSpread) +
+                           std::ceil(maxModulationTime * sampleRate);
+
+  return juce::nextPowerOfTwo(
+      static_cast<int>(std::floor(longestDelayInSamples)) + 3);
+}
+
+void CombBank::updateLanes(bool shouldRampFeedback) {
+  interpolating = false;
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto comb = static_cast<size_t>(lane % combLanes);
+    auto laneIndex = static_cast<size_t>(lane);
+
+    // Padding lanes run silently with no feedback. They read the oldest
+    // row rather than the newest, as reading back the row the last sample
+    // stored would hold every gather up until that store had gone through
+    if (lane % combLanes >= numCombs) {
+      feedback[laneIndex] = 0.0f;
+      outputGain[laneIndex] = 0.0f;
+      delayWhole[laneIndex] = ringMask;
+      delayFraction[laneIndex] = 0.0f;
+      laneDelays[laneIndex] = static_cast<float>(ringMask);
+      continue;
+    }
+
+    auto delayTimeInSamples = (delayTimes[comb] * delayScale / 1000.0f) * sampleRate;
+
+    // The right channel is spread out from the left
+    if (lane >= combLanes) {
+      delayTimeInSamples += static_cast<float>(stereoSpread);
+    }
+
+    if (!interpolated) {
+      delayTimeInSamples = std::round(delayTimeInSamples);
+    }
+
+    auto whole = std::floor(delayTimeInSamples);
+
+    delayWhole[laneIndex] = static_cast<int32_t>(whole);
+    delayFraction[laneIndex] = delayTimeInSamples - whole;
+    interpolating = interpolating || delayFraction[laneIndex] != 0.0f;
+
+    laneDelays[laneIndex] = delayTimeInSamples;
+    outputGain[laneIndex] = 1.0f / static_cast<float>(numCombs);
+  }
+
+  // The delays or the signs have changed, so the feedback has to be set
+  // again even if the decay hasn't
+  feedbackCache.invalidate();
+  updateFeedback(shouldRampFeedback);
+}
+
+void CombBank::startTapCrossfade() noexcept {
+  fromDelayWhole = delayWhole;
+  fromDelayFraction = delayFraction;
+  fromLaneDelays = laneDelays;
+  auto fromInterpolating = interpolating;
+
+  // The feedback ramps to suit the new delays over the same time as the
+  // taps fade, so the crossfade always ends with or before the ramp
+  delayScale = targetDelayScale;
+  updateLanes(true);
+
+  auto crossfadeLength = static_cast<int>(feedbackRampTime * sampleRate);
+
+  if (crossfadeLength < 1)
+    return;
+
+  interpolating = interpolating || fromInterpolating;
+  tapFade = 0.0f;
+  tapFadeStep = 1.0f / static_cast<float>(crossfadeLength);
+  crossfadeSamplesRemaining = crossfadeLength;
+}
+
+void CombBank::advanceTapCrossfade(int numSamples) noexcept {
+  crossfadeSamplesRemaining -= std::min(numSamples, crossfadeSamplesRemaining);
+
+  if (crossfadeSamplesRemaining > 0)
+    return;
+
+  // The old taps may have been the only fractional ones
+  interpolating = false;
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    interpolating = interpolating || delayFraction[static_cast<size_t>(lane)] != 0.0f;
+  }
+}
+
+void CombBank::updateFeedback(bool shouldRamp) {
+  if (!feedbackCache.update({ decayTime, sampleRate }))
+    return;
+
+  // The gain that decays each lane's delay by 60 dB in decayTime, as
+  // computeDecayGains works it out, but kept as log2 of the gain, which is
+  // limited to log2(0.95)
+  constexpr float maxLogFeedback = -0.07400058f;
+  auto exponentPerSample = getDecayExponent(decayTime, sampleRate);
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    targetLogFeedback[l] =
+        std::min(laneDelays[l] * exponentPerSample, maxLogFeedback);
+  }
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    auto comb = static_cast<size_t>(lane % combLanes);
+
+    // Padding lanes run silently with no feedback
+    if (lane % combLanes >= numCombs) {
+      targetFeedback[l] = 0.0f;
+      continue;
+    }
+
+    auto combFeedback = fastExp2(targetLogFeedback[l]);
+    targetFeedback[l] = phaseFlipped[comb] ? -combFeedback : combFeedback;
+  }
+
+  auto rampLength = static_cast<int>(feedbackRampTime * sampleRate);
+
+  // A crossfade has to end with or before a ramp, so while one is running
+  // the feedback ramps even when asked to jump
+  shouldRamp = shouldRamp || crossfadeSamplesRemaining > 0;
+
+  if (!shouldRamp || rampLength < 1) {
+    finishFeedbackRamp();
+    return;
+  }
+
+  // Restart the ramp from wherever the last one had got to. A ratio of
+  // 2^step takes each gain the rest of the way in rampLength samples
+  auto inverseRampLength = 1.0f / static_cast<float>(rampLength);
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    logFeedbackStep[l] = (targetLogFeedback[l] - logFeedback[l]) * inverseRampLength;
+    feedbackRatio[l] = fastExp2(logFeedbackStep[l]);
+  }
+
+  rampSamplesRemaining = rampLength;
+}
+
+void CombBank::updateDamping() noexcept {
+  if (!dampingCache.update({ damping, sampleRate }))
+    return;
+
+  // No damping has to be exactly no filter, so the kernels reproduce the
+  // undamped combs bit for bit
+  if (damping == 0.0f) {
+    dampingPole = 0.0f;
+    return;
+  }
+
+  // The pole that has the same time constant at this sample rate as the
+  // damped one has at the reference rate, pole^(reference / rate). Poles
+  // too small for fastExp2() are as good as none
+  auto referencePole = damping * maxDampingPole;
+  auto exponent = std::log2(referencePole) * dampingReferenceRate / sampleRate;
+  dampingPole = fastExp2(std::max(exponent, -126.0f));
+}
+
+void CombBank::advanceFeedbackRamp(int numSamples) noexcept {
+  auto numSteps = std::min(numSamples, rampSamplesRemaining);
+  rampSamplesRemaining -= numSteps;
+
+  if (rampSamplesRemaining == 0) {
+    finishFeedbackRamp();
+    return;
+  }
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    logFeedback[l] += static_cast<float>(numSteps) * logFeedbackStep[l];
+  }
+}
+
+void CombBank::finishFeedbackRamp() noexcept {
+  // Land exactly on the target, rather than wherever the rounding of all
+  // the ramp's multiplies left the gains
+  feedback = targetFeedback;
+  logFeedback = targetLogFeedback;
+  rampSamplesRemaining = 0;
+}
+
+int CombBank::loadModulationLine(int sample, float* offsets,
+                                 float* steps) const noexcept {
+  jassert(modulation != nullptr);
+
+  auto line = sample < modulationFirstLineLength
+                  ? 0
+                  : 1 + (sample - modulationFirstLineLength) / modulationLineLength;
+  auto lineStart =
+      line == 0 ? 0 : modulationFirstLineLength + (line - 1) * modulationLineLength;
+  auto* values = modulation + static_cast<size_t>(line) * 2 * maxNumLanes;
+  auto position = static_cast<float>(sample - lineStart);
+
+  // A range can start part way along a line
+  for (int lane = 0; lane < numLanes; ++lane) {
+    steps[lane] = values[maxNumLanes + lane];
+    offsets[lane] = values[lane] + position * steps[lane];
+  }
+
+  return lineStart + (line == 0 ? modulationFirstLineLength : modulationLineLength);
+}
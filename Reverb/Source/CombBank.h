@@ -0,0 +1,295 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AlignedArena.h"
+#include "Coefficients.h"
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/**
+ * A bank of parallel feedback comb filters that are processed together.
+ *
+ * The state of every comb is kept in structure-of-arrays form, with one lane
+ * per comb and channel, so a single SIMD instruction advances several combs
+ * at once. Lanes are laid out channel-major: the first combLanes lanes belong
+ * to the left channel and the next combLanes to the right. The number of
+ * combs is rounded up to 4 or 8 lanes per channel, and padding lanes are
+ * silenced with a zero output gain. A mono bank is always padded to 8 lanes
+ * when the CPU has AVX2, so it fills a whole AVX2 register.
+ *
+ * Both channels advance together in the same loop. The right channel's
+ * combs can be made longer than the left's by a fixed number of samples,
+ * as in Freeverb's stereo spread, so the two channels decorrelate.
+ *
+ * The delay memory is interleaved by lane and all lanes share one write
+ * position, so each sample writes a whole row of lanes with one store.
+ * The ring is taken from an AlignedArena owned by the caller.
+ *
+ * A new decay doesn't step the feedback. Every lane ramps from its current
+ * gain to the new one over feedbackRampTime, linearly in log2 of the gain,
+ * so each sample of the ramp only multiplies the gain by a fixed ratio and
+ * the kernels never need an exp or pow. The ramp carries on across blocks,
+ * so it is the same length whatever the host's block size.
+ *
+ * Every delay can be scaled while the bank runs, e.g. by a room size
+ * control. The ring is always sized for maxDelayScale, so a new scale never
+ * allocates and never loses the tail. Rather than jump to the new delays,
+ * each lane keeps reading its old tap too and crossfades to the new one
+ * over feedbackRampTime, alongside the ramp of its feedback to the new
+ * delay's. A scale set during a crossfade waits for it to finish.
+ *
+ * The delays can also be modulated, by offsets for every lane drawn as
+ * straight lines across the block ahead, e.g. by an LfoBank. While they
+ * are, the kernels step each lane's offset along its line, work out its
+ * whole and fractional delay every sample and always interpolate. Without
+ * them they go back to the fixed delays, and skip the interpolation again
+ * if those are whole.
+ *
+ * Each comb's feedback can also be damped by a one-pole low-pass, as in
+ * Freeverb, so the highs die away faster than the lows like they do in a
+ * real room. The low-pass is part of the comb recurrence itself, a subtract
+ * and a multiply-add per lane and sample, rather than a filter pass of its
+ * own, and it has unity gain at DC, so the decay of the lows is unchanged.
+ * Its pole is only worked out again when the damping or the sample rate
+ * changes.
+ *
+ * The kernel is picked from the CPU's features the first time it is needed,
+ * falling back to plain scalar code when no SIMD kernel fits. For input in
+ * [-1, 1] every SIMD kernel matches the scalar one to within maxKernelError,
+ * padded mono banks included; the difference only comes from the order in
+ * which the floating point operations are done. The kernel check in
+ * Reverb/Benchmarks holds every kernel the CPU runs to this.
+ */
+class CombBank {
+public:
+  static constexpr int maxNumCombs = 8;
+  static constexpr int maxNumChannels = 2;
+  static constexpr int maxStereoSpread = 256;  // in samples
+  static constexpr float feedbackRampTime = 0.02f;  // in seconds
+  static constexpr float maxDelayScale = 1.5f;
+  static constexpr float maxModulationTime = 0.001f;  // in seconds
+  static constexpr int maxNumLanes = maxNumCombs * maxNumChannels;
+
+  // How far a SIMD kernel's output may be from the scalar kernel's, for
+  // input in [-1, 1]
+  static constexpr float maxKernelError = 1e-5f;
+
+  // The damping low-pass's pole at full damping, at dampingReferenceRate.
+  // Freeverb's damping goes up to 0.4 at the same rate
+  static constexpr float maxDampingPole = 0.7f;
+  static constexpr float dampingReferenceRate = 44100.0f;  // in Hz
+
+  enum class Kernel { scalar, sse2, avx2 };
+
+  void setDelayTime(int comb, float value);
+  void setPhaseFlipped(int comb, bool flipped);
+
+  // Ramps the feedback to the one for this decay, or jumps straight to it
+  // when shouldRamp is false, unless the taps are crossfading to a new
+  // delay scale, which always ramps. Changing the delays always jumps
+  void setFeedback(float decay, bool shouldRamp = true);
+  void setSampleRate(float value);
+
+  // Multiplies every delay time by the scale, which goes up to
+  // maxDelayScale. Before prepare() it takes effect at once, and after it
+  // the read taps crossfade to it. Safe to call from the audio thread
+  void setDelayScale(float scale);
+  float getDelayScale() const noexcept { return targetDelayScale; }
+
+  // How much the feedback is low-passed, from 0 to 1. At 0 the combs aren't
+  // damped at all. The filter keeps the same cutoff at any sample rate.
+  // Safe to call from the audio thread
+  void setDamping(float amount);
+
+  // Has each lane's delay moved by an offset, in samples, drawn as a run of
+  // straight lines across the block passed to the next process(). Each line
+  // is a row of maxNumLanes offsets at its first sample, then a row of how
+  // far each one moves every sample after that. The first line covers the
+  // block's first firstLineLength samples, and every line after it
+  // lineLength, or up to the end of the block. Offsets can be up to
+  // maxModulationTime either way. The lines must stay valid until then.
+  // nullptr stops the modulation
+  void setModulation(const float* newLines, int firstLineLength, int lineLength) noexcept {
+    jassert(newLines == nullptr || (firstLineLength > 0 && lineLength > 0));
+    modulation = newLines;
+    modulationFirstLineLength = firstLineLength;
+    modulationLineLength = lineLength;
+  }
+
+  // When interpolation is off, every delay is rounded to a whole number of
+  // samples and the kernels skip the fractional read altogether. They also
+  // skip it when interpolation is on but every delay is already whole
+  void setInterpolated(bool shouldInterpolate);
+
+  // Lengthens every comb of the right channel by this many samples. The
+  // ring always has room for maxStereoSpread, so this can be changed
+  // without preparing again
+  void setStereoSpread(int samples);
+
+  // Bytes prepare() takes from the arena for the current delay times and
+  // sample rate
+  size_t getMemorySize(int numberOfCombs, int numberOfChannels) const;
+
+  // The ring is taken from the arena, which must outlive the bank
+  void prepare(float samplingRate, int numberOfCombs, int numberOfChannels,
+               AlignedArena& arena);
+  void reset() noexcept;
+
+  // The largest magnitude of anything in the combs' delay lines
+  float getPeakLevel() const noexcept;
+
+  // Runs every comb over the input and writes their average to the output.
+  // The two buffers may be the same
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output);
+
+  // Same as above, but every averaged sample is passed through outputStage
+  // before it is written, so later stages can be fused into the comb loop.
+  // The stage is called as outputStage(channel, sample, input, combOutput)
+  // and returns the sample to write. Defined in CombBankKernels.h
+  template <typename OutputStage>
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output, OutputStage& outputStage);
+
+  int getNumCombs() const noexcept { return numCombs; }
+
+  // How many lanes the combs take up, padding included, which is how many
+  // modulation offsets each sample needs
+  int getNumLanes() const noexcept { return numLanes; }
+
+  // Lets the kernel be forced, e.g. to compare against the scalar path.
+  // Kernels the CPU can't run, or that don't fit the lane count, are ignored
+  void setKernel(Kernel newKernel);
+  Kernel getKernel() const noexcept { return kernel; }
+
+  // The fastest kernel this CPU supports
+  static Kernel getBestAvailableKernel();
+
+private:
+  static bool isKernelUsable(Kernel kernelToCheck, int numberOfLanes);
+  static int getCombLanes(int numberOfCombs, int numberOfChannels);
+  static int getNumLanes(int numberOfCombs, int numberOfChannels);
+  int getNumRows(int numberOfCombs) const;
+  void updateLanes(bool shouldRampFeedback = false);
+
+  // Moves every lane's read tap to the target delay scale, fading from the
+  // old tap to the new one
+  void startTapCrossfade() noexcept;
+  void advanceTapCrossfade(int numSamples) noexcept;
+
+  // Works out every lane's feedback from the decay, if it has changed since
+  // it was last worked out, and either ramps to it or jumps straight to it
+  void updateFeedback(bool shouldRamp);
+
+  // Works out the damping pole, if the damping or the sample rate have
+  // changed since it was last worked out
+  void updateDamping() noexcept;
+
+  // Moves the ramp on by the samples a kernel has just processed
+  void advanceFeedbackRamp(int numSamples) noexcept;
+  void finishFeedbackRamp() noexcept;
+
+  // Writes every lane's modulation offset at a sample of the block, and how
+  // far it moves each sample, from the line the sample falls on. Returns
+  // the sample the next line starts at
+  int loadModulationLine(int sample, float* offsets, float* steps) const noexcept;
+
+  // What the kernels start each lane's last whole delay at, which no lane's
+  // delay can ever be
+  static constexpr int32_t lastWholeUnset = std::numeric_limits<int32_t>::min();
+
+  // A crossfade only ever runs during a feedback ramp, so Crossfade implies
+  // Ramp, and modulated delays are always interpolated, so Modulate implies
+  // Interpolate
+  template <bool Ramp, bool Crossfade, typename OutputStage>
+  void processRange(const float* const*, float* const*, int, int,
+                    OutputStage&);
+  template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+            typename OutputStage>
+  void processWithKernel(const float* const*, float* const*, int, int,
+                         OutputStage&);
+
+  template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+            typename OutputStage>
+  static void processScalar(CombBank&, const float* const*, float* const*,
+                            int, int, OutputStage&);
+  template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+            typename OutputStage>
+  static void processSSE2(CombBank&, const float* const*, float* const*, int,
+                          int, OutputStage&);
+  template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+            typename OutputStage>
+  static void processAVX2(CombBank&, const float* const*, float* const*, int,
+                          int, OutputStage&);
+
+  float sampleRate = 44100.0f;  // sample rate in Hz
+  float decayTime = 1.0f;       // decay in seconds the feedback is set from
+  float delayScale = 1.0f;      // what the lanes' delays are scaled by now
+  float targetDelayScale = 1.0f;  // and what they will be once a crossfade ends
+
+  int numCombs = 0;
+  int numChannels = 0;
+  int combLanes = 0;  // lanes per channel
+  int numLanes = 0;   // combLanes * numChannels
+  int laneShift = 0;  // log2(numLanes)
+
+  int stereoSpread = 0;        // extra delay of the right channel in samples
+  bool interpolated = true;    // whether fractional delays are kept
+  bool interpolating = false;  // whether any lane has a fractional delay
+
+  std::array<float, maxNumCombs> delayTimes {};  // in ms
+  std::array<bool, maxNumCombs> phaseFlipped {};
+
+  // Per lane state, read straight into SIMD registers by the kernels
+  alignas(64) std::array<float, maxNumLanes> feedback {};
+  alignas(64) std::array<float, maxNumLanes> outputGain {};
+  alignas(64) std::array<float, maxNumLanes> delayFraction {};
+  alignas(64) std::array<int32_t, maxNumLanes> delayWhole {};
+
+  // Each lane's read tap from before the delay scale changed, which the
+  // kernels fade out over a crossfade
+  alignas(64) std::array<float, maxNumLanes> fromDelayFraction {};
+  alignas(64) std::array<int32_t, maxNumLanes> fromDelayWhole {};
+  alignas(64) std::array<float, maxNumLanes> fromLaneDelays {};
+
+  // How far into a crossfade the new taps are, and how far they move each
+  // sample
+  float tapFade = 0.0f;
+  float tapFadeStep = 0.0f;
+  int crossfadeSamplesRemaining = 0;
+
+  // The damping low-pass's pole, and its output for every lane, which is
+  // what the feedback is taken from
+  float damping = 0.0f;      // from 0 to 1
+  float dampingPole = 0.0f;  // 0 is no damping
+  CoefficientCache<2> dampingCache;  // from the damping and the sample rate
+  alignas(64) std::array<float, maxNumLanes> dampingState {};
+
+  // Lines of offsets to every lane's delay for the next block, or nullptr,
+  // and how many samples they each cover
+  const float* modulation = nullptr;
+  int modulationFirstLineLength = 0;
+  int modulationLineLength = 0;
+
+  // What each lane's feedback is multiplied by every sample of a ramp
+  alignas(64) std::array<float, maxNumLanes> feedbackRatio {};
+
+  // Each lane's whole delay in samples, which its feedback is set from
+  alignas(64) std::array<float, maxNumLanes> laneDelays {};
+  CoefficientCache<2> feedbackCache;  // from the decay and the sample rate
+
+  // The feedback each lane is ramping to, and log2 of its magnitude now,
+  // where it is heading and how far it moves each sample
+  std::array<float, maxNumLanes> targetFeedback {};
+  std::array<float, maxNumLanes> logFeedback {};
+  std::array<float, maxNumLanes> targetLogFeedback {};
+  std::array<float, maxNumLanes> logFeedbackStep {};
+  int rampSamplesRemaining = 0;
+
+  float* ring = nullptr;  // numLanes interleaved delay lines
+  int ringMask = 0;       // number of rows in the ring - 1
+  int writeRow = 0;         // row the next sample is written to
+
+  Kernel kernel = Kernel::scalar;
+};
@@ -0,0 +1,646 @@
+#pragma once
+
+#include "CombBank.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+
+ // Lets the SIMD kernels use instructions the rest of the
+ // plugin isn't compiled for. They only run once cpuid says they can
+ #if JUCE_GCC || JUCE_CLANG
+  #define COMB_BANK_TARGET(isa) __attribute__((target(isa)))
+ #else
+  #define COMB_BANK_TARGET(isa)
+ #endif
+#endif
+
+// The comb bank's kernels live here rather than in CombBank.cpp because they
+// are templated on the stage each output sample passes through. Include this
+// wherever CombBank::process is called with a stage of your own.
+
+template <typename OutputStage>
+void CombBank::process(const juce::AudioBuffer<float>& input,
+                       juce::AudioBuffer<float>& output,
+                       OutputStage& outputStage) {
+  jassert(input.getNumChannels() == numChannels);
+  jassert(output.getNumChannels() == numChannels);
+  jassert(output.getNumSamples() >= input.getNumSamples());
+
+  auto* inputData = input.getArrayOfReadPointers();
+  auto* outputData = output.getArrayOfWritePointers();
+  auto numSamples = input.getNumSamples();
+
+  // The samples the taps crossfade over, then the rest of the ones the
+  // feedback ramps over, each run through a kernel of their own and the
+  // rest of the block through the fixed one, so none of them has to check
+  // whether the fade or the ramp has ended on every sample. A crossfade
+  // never outlasts the ramp it started with
+  int start = 0;
+
+  while (start < numSamples) {
+    if (crossfadeSamplesRemaining == 0 && targetDelayScale != delayScale)
+      startTapCrossfade();
+
+    if (crossfadeSamplesRemaining > 0) {
+      jassert(crossfadeSamplesRemaining <= rampSamplesRemaining);
+      auto end = std::min(numSamples, start + crossfadeSamplesRemaining);
+      processRange<true, true>(inputData, outputData, start, end, outputStage);
+      advanceFeedbackRamp(end - start);
+      advanceTapCrossfade(end - start);
+      start = end;
+    } else if (rampSamplesRemaining > 0) {
+      auto end = std::min(numSamples, start + rampSamplesRemaining);
+      processRange<true, false>(inputData, outputData, start, end, outputStage);
+      advanceFeedbackRamp(end - start);
+      start = end;
+    } else {
+      processRange<false, false>(inputData, outputData, start, numSamples, outputStage);
+      start = numSamples;
+    }
+  }
+}
+
+template <bool Ramp, bool Crossfade, typename OutputStage>
+void CombBank::processRange(const float* const* input, float* const* output,
+                            int startSample, int endSample,
+                            OutputStage& outputStage) {
+  if (modulation != nullptr) {
+    processWithKernel<true, Ramp, Crossfade, true>(input, output, startSample, endSample,
+                                                   outputStage);
+  } else if (interpolating) {
+    processWithKernel<true, Ramp, Crossfade, false>(input, output, startSample, endSample,
+                                                    outputStage);
+  } else {
+    processWithKernel<false, Ramp, Crossfade, false>(input, output, startSample, endSample,
+                                                     outputStage);
+  }
+}
+
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+void CombBank::processWithKernel(const float* const* input,
+                                 float* const* output, int startSample,
+                                 int endSample, OutputStage& outputStage) {
+  switch (kernel) {
+    case Kernel::avx2:
+      processAVX2<Interpolate, Ramp, Crossfade, Modulate>(*this, input, output, startSample,
+                                                          endSample, outputStage);
+      break;
+    case Kernel::sse2:
+      processSSE2<Interpolate, Ramp, Crossfade, Modulate>(*this, input, output, startSample,
+                                                          endSample, outputStage);
+      break;
+    case Kernel::scalar:
+    default:
+      processScalar<Interpolate, Ramp, Crossfade, Modulate>(*this, input, output, startSample,
+                                                            endSample, outputStage);
+      break;
+  }
+}
+
+//==============================================================================
+// Kernels
+//
+// Every kernel runs the same recurrence for each lane:
+//   delayed   = lerp(y[n - 1 - whole], y[n - 2 - whole], fraction)
+//   damped[n] = delayed + pole * (damped[n - 1] - delayed)
+//   y[n]      = x[n] + feedback * damped[n]
+// and then sums each channel's lanes, weighted by their output gain.
+// The damping always runs, as a pole of 0 leaves delayed exactly as it is.
+// When none of the delays has a fractional part the kernels are built with
+// Interpolate = false, which skips the second read and the lerp. When they
+// do, y[n - 2 - whole] is what the lane read as y[n - 1 - whole] on the
+// sample before, as long as whole hasn't changed since, so each kernel keeps
+// the last sample's reads and only goes back to the ring for lanes whose
+// whole delay has moved. That is every lane on a range's first sample.
+// While the feedback is ramping they are built with Ramp = true, and every
+// lane's feedback is multiplied by its ratio before each sample, then
+// written back for the next block.
+// While the taps crossfade to new delays they are built with
+// Crossfade = true, and read each lane at its old delays as well as its new
+// ones, fading from one to the other by a gain that steps up every sample:
+//   delayed  = from + fade * (to - from)
+// While the delays are modulated they are built with Modulate = true, and
+// work out every lane's whole and fraction each sample from its delay plus
+// its offset, which steps along the current line and is reloaded when the
+// next one starts. Truncating is the same as floor for every delay but a
+// padding lane's, which is silent whatever it reads.
+// Each kernel processes the samples from startSample up to endSample.
+// Row r of the ring holds y for every lane at one point in time. The ring
+// always has room for two rows past the longest delay, so the rows a sample
+// reads never overlap the one it writes.
+
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+void CombBank::processScalar(CombBank& bank, const float* const* input,
+                             float* const* output, int startSample,
+                             int endSample, OutputStage& outputStage) {
+  auto* ring = bank.ring;
+  const auto numLanes = bank.numLanes;
+  const auto combLanes = bank.combLanes;
+  const auto mask = bank.ringMask;
+  const auto pole = bank.dampingPole;
+  auto writeRow = bank.writeRow;
+  auto fade = bank.tapFade;
+
+  // Kept in a copy of its own, as the compiler can't tell the ring's
+  // writes don't touch the bank's
+  auto damped = bank.dampingState;
+
+  // Each lane's last newest read and the whole delay it was read at. No
+  // delay is ever lastWholeUnset, so the first sample reads both
+  std::array<float, maxNumLanes> lastNewest {};
+  std::array<int32_t, maxNumLanes> lastWhole;
+  lastWhole.fill(lastWholeUnset);
+
+  // Each lane's modulation offset and how far it moves each sample. The
+  // first sample loads them
+  std::array<float, maxNumLanes> offsets {}, offsetSteps {};
+  auto nextLineStart = Modulate ? startSample : endSample;
+
+  for (int i = startSample; i < endSample; ++i) {
+    auto* row = ring + writeRow * numLanes;
+
+    if constexpr (Modulate) {
+      if (i == nextLineStart)
+        nextLineStart = bank.loadModulationLine(i, offsets.data(), offsetSteps.data());
+    }
+
+    if constexpr (Crossfade) {
+      fade += bank.tapFadeStep;
+    }
+
+    if constexpr (Ramp) {
+      for (int lane = 0; lane < numLanes; ++lane) {
+        auto l = static_cast<size_t>(lane);
+        bank.feedback[l] *= bank.feedbackRatio[l];
+      }
+    }
+
+    for (int channel = 0; channel < bank.numChannels; ++channel) {
+      auto inputSample = input[channel][i];
+      float sum = 0.0f;
+
+      for (int lane = channel * combLanes; lane < (channel + 1) * combLanes;
+           ++lane) {
+        auto l = static_cast<size_t>(lane);
+        auto whole = bank.delayWhole[l];
+        auto fraction = bank.delayFraction[l];
+
+        if constexpr (Modulate) {
+          auto delay = bank.laneDelays[l] + offsets[l];
+          whole = static_cast<int32_t>(delay);
+          fraction = delay - static_cast<float>(whole);
+        }
+
+        auto newestRow = (writeRow - 1 - whole) & mask;
+        auto delayed = ring[newestRow * numLanes + lane];
+
+        if constexpr (Interpolate) {
+          auto oldest = lastNewest[l];
+
+          if (whole != lastWhole[l])
+            oldest = ring[((newestRow - 1) & mask) * numLanes + lane];
+
+          lastNewest[l] = delayed;
+          lastWhole[l] = whole;
+          delayed += fraction * (oldest - delayed);
+        }
+
+        if constexpr (Crossfade) {
+          auto fromWhole = bank.fromDelayWhole[l];
+          auto fromFraction = bank.fromDelayFraction[l];
+
+          if constexpr (Modulate) {
+            auto delay = bank.fromLaneDelays[l] + offsets[l];
+            fromWhole = static_cast<int32_t>(delay);
+            fromFraction = delay - static_cast<float>(fromWhole);
+          }
+
+          auto fromRow = (writeRow - 1 - fromWhole) & mask;
+          auto from = ring[fromRow * numLanes + lane];
+
+          if constexpr (Interpolate) {
+            auto oldest = ring[((fromRow - 1) & mask) * numLanes + lane];
+            from += fromFraction * (oldest - from);
+          }
+
+          delayed = from + fade * (delayed - from);
+        }
+
+        if constexpr (Modulate) {
+          offsets[l] += offsetSteps[l];
+        }
+
+        damped[l] = delayed + pole * (damped[l] - delayed);
+        auto filteredSample = inputSample + bank.feedback[l] * damped[l];
+        row[lane] = filteredSample;
+        sum += bank.outputGain[l] * filteredSample;
+      }
+
+      output[channel][i] = outputStage(channel, i, inputSample, sum);
+    }
+
+    writeRow = (writeRow + 1) & mask;
+  }
+
+  bank.writeRow = writeRow;
+  bank.dampingState = damped;
+
+  if constexpr (Crossfade) {
+    bank.tapFade = fade;
+  }
+}
+
+#if JUCE_INTEL
+
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+COMB_BANK_TARGET("sse2")
+void CombBank::processSSE2(CombBank& bank, const float* const* input,
+                           float* const* output, int startSample,
+                           int endSample, OutputStage& outputStage) {
+  // SSE2 has no gather, so the delayed samples are loaded one lane at a time
+  // and only the arithmetic runs four lanes wide
+  auto* ring = bank.ring;
+  const auto registersPerChannel = bank.combLanes / 4;
+  const auto mask = _mm_set1_epi32(bank.ringMask);
+  const auto shift = _mm_cvtsi32_si128(bank.laneShift);
+  const auto pole = _mm_set1_ps(bank.dampingPole);
+  auto writeRow = bank.writeRow;
+  auto fade = bank.tapFade;
+
+  // Each lane's last newest read and the whole delay it was read at
+  alignas(16) std::array<float, maxNumLanes> lastNewest {};
+  alignas(16) std::array<int32_t, maxNumLanes> lastWhole;
+  lastWhole.fill(lastWholeUnset);
+
+  // Each lane's modulation offset and how far it moves each sample
+  alignas(16) std::array<float, maxNumLanes> offsets {}, offsetSteps {};
+  auto nextLineStart = Modulate ? startSample : endSample;
+
+  for (int i = startSample; i < endSample; ++i) {
+    auto* row = ring + writeRow * bank.numLanes;
+    const auto newestRow = _mm_set1_epi32(writeRow - 1);
+
+    if constexpr (Modulate) {
+      if (i == nextLineStart)
+        nextLineStart = bank.loadModulationLine(i, offsets.data(), offsetSteps.data());
+    }
+
+    if constexpr (Crossfade) {
+      fade += bank.tapFadeStep;
+    }
+
+    for (int channel = 0; channel < bank.numChannels; ++channel) {
+      const auto inputSample = input[channel][i];
+      const auto x = _mm_set1_ps(inputSample);
+      auto sum = _mm_setzero_ps();
+
+      for (int r = channel * registersPerChannel;
+           r < (channel + 1) * registersPerChannel; ++r) {
+        const auto lane = r * 4;
+        auto whole = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(bank.delayWhole.data() + lane));
+        auto fraction = _mm_load_ps(bank.delayFraction.data() + lane);
+        auto offset = _mm_setzero_ps();
+
+        if constexpr (Modulate) {
+          offset = _mm_load_ps(offsets.data() + lane);
+          _mm_store_ps(offsets.data() + lane,
+                       _mm_add_ps(offset, _mm_load_ps(offsetSteps.data() + lane)));
+
+          const auto delay = _mm_add_ps(_mm_load_ps(bank.laneDelays.data() + lane), offset);
+          whole = _mm_cvttps_epi32(delay);
+          fraction = _mm_sub_ps(delay, _mm_cvtepi32_ps(whole));
+        }
+
+        const auto laneIndex = _mm_setr_epi32(lane, lane + 1, lane + 2, lane + 3);
+
+        auto rows = _mm_and_si128(_mm_sub_epi32(newestRow, whole), mask);
+        alignas(16) int32_t newestIndex[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(newestIndex),
+                        _mm_add_epi32(_mm_sll_epi32(rows, shift), laneIndex));
+
+        auto delayed =
+            _mm_setr_ps(ring[newestIndex[0]], ring[newestIndex[1]],
+                        ring[newestIndex[2]], ring[newestIndex[3]]);
+
+        if constexpr (Interpolate) {
+          auto oldest = _mm_load_ps(lastNewest.data() + lane);
+          const auto unchanged = _mm_cmpeq_epi32(
+              whole, _mm_load_si128(reinterpret_cast<const __m128i*>(lastWhole.data() + lane)));
+
+          if (_mm_movemask_ps(_mm_castsi128_ps(unchanged)) != 0xf) {
+            rows = _mm_and_si128(_mm_sub_epi32(rows, _mm_set1_epi32(1)), mask);
+            alignas(16) int32_t oldestIndex[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(oldestIndex),
+                            _mm_add_epi32(_mm_sll_epi32(rows, shift), laneIndex));
+
+            oldest = _mm_setr_ps(ring[oldestIndex[0]], ring[oldestIndex[1]],
+                                 ring[oldestIndex[2]], ring[oldestIndex[3]]);
+          }
+
+          _mm_store_ps(lastNewest.data() + lane, delayed);
+          _mm_store_si128(reinterpret_cast<__m128i*>(lastWhole.data() + lane), whole);
+          delayed = _mm_add_ps(
+              delayed, _mm_mul_ps(fraction, _mm_sub_ps(oldest, delayed)));
+        }
+
+        if constexpr (Crossfade) {
+          auto fromWhole = _mm_load_si128(
+              reinterpret_cast<const __m128i*>(bank.fromDelayWhole.data() + lane));
+          auto fromFraction = _mm_load_ps(bank.fromDelayFraction.data() + lane);
+
+          if constexpr (Modulate) {
+            const auto delay =
+                _mm_add_ps(_mm_load_ps(bank.fromLaneDelays.data() + lane), offset);
+            fromWhole = _mm_cvttps_epi32(delay);
+            fromFraction = _mm_sub_ps(delay, _mm_cvtepi32_ps(fromWhole));
+          }
+
+          rows = _mm_and_si128(_mm_sub_epi32(newestRow, fromWhole), mask);
+          _mm_store_si128(reinterpret_cast<__m128i*>(newestIndex),
+                          _mm_add_epi32(_mm_sll_epi32(rows, shift), laneIndex));
+
+          auto from = _mm_setr_ps(ring[newestIndex[0]], ring[newestIndex[1]],
+                                  ring[newestIndex[2]], ring[newestIndex[3]]);
+
+          if constexpr (Interpolate) {
+            rows = _mm_and_si128(_mm_sub_epi32(rows, _mm_set1_epi32(1)), mask);
+            alignas(16) int32_t oldestIndex[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(oldestIndex),
+                            _mm_add_epi32(_mm_sll_epi32(rows, shift), laneIndex));
+
+            const auto oldest =
+                _mm_setr_ps(ring[oldestIndex[0]], ring[oldestIndex[1]],
+                            ring[oldestIndex[2]], ring[oldestIndex[3]]);
+
+            from = _mm_add_ps(from, _mm_mul_ps(fromFraction, _mm_sub_ps(oldest, from)));
+          }
+
+          delayed = _mm_add_ps(
+              from, _mm_mul_ps(_mm_set1_ps(fade), _mm_sub_ps(delayed, from)));
+        }
+
+        auto feedback = _mm_load_ps(bank.feedback.data() + lane);
+
+        if constexpr (Ramp) {
+          feedback = _mm_mul_ps(feedback, _mm_load_ps(bank.feedbackRatio.data() + lane));
+          _mm_store_ps(bank.feedback.data() + lane, feedback);
+        }
+
+        const auto state = _mm_load_ps(bank.dampingState.data() + lane);
+        const auto damped =
+            _mm_add_ps(delayed, _mm_mul_ps(pole, _mm_sub_ps(state, delayed)));
+        _mm_store_ps(bank.dampingState.data() + lane, damped);
+
+        const auto filtered = _mm_add_ps(x, _mm_mul_ps(feedback, damped));
+        _mm_storeu_ps(row + lane, filtered);
+
+        const auto gain = _mm_load_ps(bank.outputGain.data() + lane);
+        sum = _mm_add_ps(sum, _mm_mul_ps(gain, filtered));
+      }
+
+      // Horizontal sum of the channel's lanes
+      sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+      sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+      output[channel][i] =
+          outputStage(channel, i, inputSample, _mm_cvtss_f32(sum));
+    }
+
+    writeRow = (writeRow + 1) & bank.ringMask;
+  }
+
+  bank.writeRow = writeRow;
+
+  if constexpr (Crossfade) {
+    bank.tapFade = fade;
+  }
+}
+
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+COMB_BANK_TARGET("avx2,fma")
+void CombBank::processAVX2(CombBank& bank, const float* const* input,
+                           float* const* output, int startSample,
+                           int endSample, OutputStage& outputStage) {
+  auto* ring = bank.ring;
+  const auto numRegisters = bank.numLanes / 8;
+  const auto mask = _mm256_set1_epi32(bank.ringMask);
+  const auto shift = _mm_cvtsi32_si128(bank.laneShift);
+  const auto one = _mm256_set1_epi32(1);
+  const auto pole = _mm256_set1_ps(bank.dampingPole);
+
+  // With 4 combs per channel a stereo bank fits in one register,
+  // left channel in the low half and right in the high half
+  const bool bothChannelsInOneRegister = bank.combLanes < 8;
+
+  __m256 feedback[2], feedbackRatio[2], gain[2], fraction[2], fromFraction[2];
+  __m256 delays[2], fromDelays[2], damped[2];
+  __m256i whole[2], fromWhole[2], laneIndex[2];
+
+  // Each lane's last newest read and the whole delay it was read at
+  __m256 lastNewest[2];
+  __m256i lastWhole[2];
+
+  // Each lane's modulation offset and how far it moves each sample, which
+  // the first sample loads
+  __m256 offset[2], offsetStep[2];
+  auto nextLineStart = Modulate ? startSample : endSample;
+
+  for (int r = 0; r < numRegisters; ++r) {
+    const auto lane = r * 8;
+    feedback[r] = _mm256_load_ps(bank.feedback.data() + lane);
+    feedbackRatio[r] = _mm256_load_ps(bank.feedbackRatio.data() + lane);
+    gain[r] = _mm256_load_ps(bank.outputGain.data() + lane);
+    fraction[r] = _mm256_load_ps(bank.delayFraction.data() + lane);
+    whole[r] = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(bank.delayWhole.data() + lane));
+    fromFraction[r] = _mm256_load_ps(bank.fromDelayFraction.data() + lane);
+    delays[r] = _mm256_load_ps(bank.laneDelays.data() + lane);
+    fromDelays[r] = _mm256_load_ps(bank.fromLaneDelays.data() + lane);
+    damped[r] = _mm256_load_ps(bank.dampingState.data() + lane);
+    fromWhole[r] = _mm256_load_si256(
+        reinterpret_cast<const __m256i*>(bank.fromDelayWhole.data() + lane));
+    laneIndex[r] = _mm256_setr_epi32(lane, lane + 1, lane + 2, lane + 3,
+                                     lane + 4, lane + 5, lane + 6, lane + 7);
+    lastNewest[r] = _mm256_setzero_ps();
+    lastWhole[r] = _mm256_set1_epi32(lastWholeUnset);
+  }
+
+  auto writeRow = bank.writeRow;
+  auto fade = bank.tapFade;
+
+  for (int i = startSample; i < endSample; ++i) {
+    auto* row = ring + writeRow * bank.numLanes;
+    const auto newestRow = _mm256_set1_epi32(writeRow - 1);
+
+    if constexpr (Modulate) {
+      if (i == nextLineStart) {
+        alignas(32) std::array<float, maxNumLanes> offsets, offsetSteps;
+        nextLineStart = bank.loadModulationLine(i, offsets.data(), offsetSteps.data());
+
+        for (int r = 0; r < numRegisters; ++r) {
+          offset[r] = _mm256_load_ps(offsets.data() + r * 8);
+          offsetStep[r] = _mm256_load_ps(offsetSteps.data() + r * 8);
+        }
+      }
+    }
+
+    if constexpr (Crossfade) {
+      fade += bank.tapFadeStep;
+    }
+
+    float inputSamples[2];
+    __m256 filtered[2];
+
+    for (int channel = 0; channel < bank.numChannels; ++channel) {
+      inputSamples[channel] = input[channel][i];
+    }
+
+    for (int r = 0; r < numRegisters; ++r) {
+      __m256 x;
+
+      if (bothChannelsInOneRegister) {
+        x = _mm256_set_m128(_mm_set1_ps(inputSamples[1]),
+                            _mm_set1_ps(inputSamples[0]));
+      } else {
+        x = _mm256_set1_ps(inputSamples[r]);
+      }
+
+      auto laneWhole = whole[r];
+      auto laneFraction = fraction[r];
+
+      if constexpr (Modulate) {
+        const auto delay = _mm256_add_ps(delays[r], offset[r]);
+        laneWhole = _mm256_cvttps_epi32(delay);
+        laneFraction = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(laneWhole));
+      }
+
+      auto rows = _mm256_and_si256(_mm256_sub_epi32(newestRow, laneWhole), mask);
+      const auto newestIndex =
+          _mm256_add_epi32(_mm256_sll_epi32(rows, shift), laneIndex[r]);
+      auto delayed = _mm256_i32gather_ps(ring, newestIndex, 4);
+
+      if constexpr (Interpolate) {
+        auto oldest = lastNewest[r];
+        const auto unchanged = _mm256_cmpeq_epi32(laneWhole, lastWhole[r]);
+
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(unchanged)) != 0xff) {
+          rows = _mm256_and_si256(_mm256_sub_epi32(rows, one), mask);
+          const auto oldestIndex =
+              _mm256_add_epi32(_mm256_sll_epi32(rows, shift), laneIndex[r]);
+          oldest = _mm256_i32gather_ps(ring, oldestIndex, 4);
+        }
+
+        lastNewest[r] = delayed;
+        lastWhole[r] = laneWhole;
+        delayed =
+            _mm256_fmadd_ps(laneFraction, _mm256_sub_ps(oldest, delayed), delayed);
+      }
+
+      if constexpr (Crossfade) {
+        auto laneFromWhole = fromWhole[r];
+        auto laneFromFraction = fromFraction[r];
+
+        if constexpr (Modulate) {
+          const auto delay = _mm256_add_ps(fromDelays[r], offset[r]);
+          laneFromWhole = _mm256_cvttps_epi32(delay);
+          laneFromFraction = _mm256_sub_ps(delay, _mm256_cvtepi32_ps(laneFromWhole));
+        }
+
+        rows = _mm256_and_si256(_mm256_sub_epi32(newestRow, laneFromWhole), mask);
+        const auto fromIndex =
+            _mm256_add_epi32(_mm256_sll_epi32(rows, shift), laneIndex[r]);
+        auto from = _mm256_i32gather_ps(ring, fromIndex, 4);
+
+        if constexpr (Interpolate) {
+          rows = _mm256_and_si256(_mm256_sub_epi32(rows, one), mask);
+          const auto oldestIndex =
+              _mm256_add_epi32(_mm256_sll_epi32(rows, shift), laneIndex[r]);
+          const auto oldest = _mm256_i32gather_ps(ring, oldestIndex, 4);
+          from = _mm256_fmadd_ps(laneFromFraction, _mm256_sub_ps(oldest, from), from);
+        }
+
+        delayed = _mm256_fmadd_ps(_mm256_set1_ps(fade),
+                                  _mm256_sub_ps(delayed, from), from);
+      }
+
+      if constexpr (Modulate) {
+        offset[r] = _mm256_add_ps(offset[r], offsetStep[r]);
+      }
+
+      if constexpr (Ramp) {
+        feedback[r] = _mm256_mul_ps(feedback[r], feedbackRatio[r]);
+      }
+
+      damped[r] = _mm256_fmadd_ps(pole, _mm256_sub_ps(damped[r], delayed), delayed);
+      filtered[r] = _mm256_fmadd_ps(feedback[r], damped[r], x);
+      _mm256_storeu_ps(row + r * 8, filtered[r]);
+    }
+
+    if (bothChannelsInOneRegister) {
+      const auto weighted = _mm256_mul_ps(gain[0], filtered[0]);
+      auto sums = _mm_hadd_ps(_mm256_castps256_ps128(weighted),
+                              _mm256_extractf128_ps(weighted, 1));
+      sums = _mm_hadd_ps(sums, sums);
+
+      output[0][i] = outputStage(0, i, inputSamples[0], _mm_cvtss_f32(sums));
+      output[1][i] = outputStage(1, i, inputSamples[1],
+                                 _mm_cvtss_f32(_mm_shuffle_ps(sums, sums, 1)));
+    } else {
+      for (int r = 0; r < numRegisters; ++r) {
+        const auto weighted = _mm256_mul_ps(gain[r], filtered[r]);
+        auto sum = _mm_add_ps(_mm256_castps256_ps128(weighted),
+                              _mm256_extractf128_ps(weighted, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        output[r][i] =
+            outputStage(r, i, inputSamples[r], _mm_cvtss_f32(sum));
+      }
+    }
+
+    writeRow = (writeRow + 1) & bank.ringMask;
+  }
+
+  bank.writeRow = writeRow;
+
+  for (int r = 0; r < numRegisters; ++r) {
+    _mm256_store_ps(bank.dampingState.data() + r * 8, damped[r]);
+  }
+
+  if constexpr (Ramp) {
+    for (int r = 0; r < numRegisters; ++r) {
+      _mm256_store_ps(bank.feedback.data() + r * 8, feedback[r]);
+    }
+  }
+
+  if constexpr (Crossfade) {
+    bank.tapFade = fade;
+  }
+}
+
+#else
+
+// Only the scalar kernel exists off x86, and isKernelUsable()
+// never lets these be picked there
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+void CombBank::processSSE2(CombBank& bank, const float* const* input,
+                           float* const* output, int startSample,
+                           int endSample, OutputStage& outputStage) {
+  processScalar<Interpolate, Ramp, Crossfade, Modulate>(bank, input, output, startSample,
+                                                        endSample, outputStage);
+}
+
+template <bool Interpolate, bool Ramp, bool Crossfade, bool Modulate,
+          typename OutputStage>
+void CombBank::processAVX2(CombBank& bank, const float* const* input,
+                           float* const* output, int startSample,
+                           int endSample, OutputStage& outputStage) {
+  processScalar<Interpolate, Ramp, Crossfade, Modulate>(bank, input, output, startSample,
+                                                        endSample, outputStage);
+}
+
+#endif
@@ -0,0 +1,494 @@
+#include "ConvolutionEngine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Non-uniform partitions start at the smallest size and grow by a factor of
+// partitionGrowth per segment, up to the largest
+constexpr int smallestPartitionSize = 64;   // in samples, also the head
+constexpr int largestPartitionSize = 4096;  // in samples
+constexpr int partitionGrowth = 8;
+
+// Uniform partitions are all this size, as is the head in front of them
+constexpr int uniformPartitionSize = 256;  // in samples
+
+// The longest head either partitioning uses
+constexpr int maxHeadSize = std::max(smallestPartitionSize, uniformPartitionSize);
+
+// Floats in each real or imaginary run of a spectrum with N + 1 bins,
+// rounded up to a whole cache line
+int getSpectrumSize(int partitionSize) {
+  return (partitionSize + 1 + 15) & ~15;
+}
+
+int getFFTOrder(int fftSize) {
+  int order = 0;
+
+  while ((1 << order) < fftSize)
+    ++order;
+
+  return order;
+}
+
+// JUCE's real FFT interleaves the real and imaginary parts of each bin, but
+// the multiply-accumulate wants them in separate runs
+void splitSpectrum(const float* interleaved, float* spectrum, int spectrumSize,
+                   int numBins) {
+  auto* real = spectrum;
+  auto* imaginary = spectrum + spectrumSize;
+
+  for (int bin = 0; bin < numBins; ++bin) {
+    real[bin] = interleaved[2 * bin];
+    imaginary[bin] = interleaved[2 * bin + 1];
+  }
+}
+
+void interleaveSpectrum(const float* spectrum, float* interleaved,
+                        int spectrumSize, int numBins) {
+  const auto* real = spectrum;
+  const auto* imaginary = spectrum + spectrumSize;
+
+  for (int bin = 0; bin < numBins; ++bin) {
+    interleaved[2 * bin] = real[bin];
+    interleaved[2 * bin + 1] = imaginary[bin];
+  }
+}
+
+// accumulator += input * filter, bin by bin. The padding bins are zero in
+// every spectrum, so the loop can run over the whole rounded-up run
+void multiplyAccumulate(float* accumulator, const float* input,
+                        const float* filter, int spectrumSize) noexcept {
+  auto* accumulatorReal = accumulator;
+  auto* accumulatorImaginary = accumulator + spectrumSize;
+  const auto* inputReal = input;
+  const auto* inputImaginary = input + spectrumSize;
+  const auto* filterReal = filter;
+  const auto* filterImaginary = filter + spectrumSize;
+
+  for (int bin = 0; bin < spectrumSize; ++bin) {
+    accumulatorReal[bin] += inputReal[bin] * filterReal[bin]
+                          - inputImaginary[bin] * filterImaginary[bin];
+    accumulatorImaginary[bin] += inputReal[bin] * filterImaginary[bin]
+                               + inputImaginary[bin] * filterReal[bin];
+  }
+}
+}
+
+ConvolutionEngine::ConvolutionEngine() {}
+
+ConvolutionEngine::~ConvolutionEngine() {
+  delete pending.exchange(nullptr);
+  delete retired.exchange(nullptr);
+}
+
+void ConvolutionEngine::setPartitioning(Partitioning newPartitioning) {
+  partitioning = newPartitioning;
+}
+
+void ConvolutionEngine::loadImpulseResponse(
+    juce::AudioBuffer<float> newImpulseResponse,
+    double newImpulseResponseSampleRate) {
+  jassert(newImpulseResponseSampleRate > 0.0);
+
+  impulseResponse = std::move(newImpulseResponse);
+  impulseResponseSampleRate = newImpulseResponseSampleRate;
+  impulseResponseLengthSeconds.store(
+      static_cast<double>(impulseResponse.getNumSamples()) / impulseResponseSampleRate,
+      std::memory_order_relaxed);
+
+  // Before prepare() the impulse response is only kept for later
+  if (auto kernel = createKernel())
+    publish(std::move(kernel));
+}
+
+void ConvolutionEngine::prepare(float samplingRate, int numberOfChannels) {
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  sampleRate = samplingRate;
+  numChannels = numberOfChannels;
+
+  // Nothing is processing, so the new kernel can go straight in
+  delete pending.exchange(nullptr);
+  releaseRetiredKernel();
+  current = createKernel();
+}
+
+void ConvolutionEngine::publish(std::unique_ptr<Kernel> kernel) {
+  releaseRetiredKernel();
+
+  // A kernel still pending was never seen by the audio thread
+  delete pending.exchange(kernel.release(), std::memory_order_acq_rel);
+}
+
+void ConvolutionEngine::releaseRetiredKernel() {
+  delete retired.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+std::unique_ptr<ConvolutionEngine::Kernel> ConvolutionEngine::createKernel() const {
+  if (sampleRate <= 0.0f || numChannels == 0 || impulseResponse.getNumSamples() == 0)
+    return nullptr;
+
+  // Resample the impulse response to the engine's rate, taking the last of
+  // its channels for any it doesn't have
+  auto speedRatio = impulseResponseSampleRate / static_cast<double>(sampleRate);
+  auto length = static_cast<int>(
+      static_cast<double>(impulseResponse.getNumSamples()) / speedRatio);
+
+  if (length <= 0)
+    return nullptr;
+
+  juce::AudioBuffer<float> taps(numChannels, length);
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    auto sourceChannel = std::min(channel, impulseResponse.getNumChannels() - 1);
+    const auto* source = impulseResponse.getReadPointer(sourceChannel);
+    auto* destination = taps.getWritePointer(channel);
+
+    if (speedRatio == 1.0) {
+      std::copy(source, source + length, destination);
+    } else {
+      juce::LagrangeInterpolator interpolator;
+      interpolator.process(speedRatio, source, destination, length);
+    }
+  }
+
+  // Scale the loudest channel to unit energy, so every impulse response
+  // comes out at about the same level
+  float energy = 0.0f;
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    const auto* channelTaps = taps.getReadPointer(channel);
+    float channelEnergy = 0.0f;
+
+    for (int i = 0; i < length; ++i) {
+      channelEnergy += channelTaps[i] * channelTaps[i];
+    }
+
+    energy = std::max(energy, channelEnergy);
+  }
+
+  if (energy > 0.0f) {
+    auto gain = 1.0f / std::sqrt(energy);
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto* channelTaps = taps.getWritePointer(channel);
+      std::transform(channelTaps, channelTaps + length, channelTaps,
+                     [gain](float tap) { return tap * gain; });
+    }
+  }
+
+  auto kernel = std::make_unique<Kernel>();
+  kernel->numChannels = numChannels;
+  kernel->length = length;
+
+  // Lay the segments out behind the head. A segment's first partition is
+  // never nearer the start than its own length, so each one can wait for a
+  // whole block of input before transforming it
+  auto uniform = partitioning == Partitioning::uniform;
+  kernel->headSize = uniform ? uniformPartitionSize : smallestPartitionSize;
+
+  auto offset = kernel->headSize;
+  auto partitionSize = kernel->headSize;
+  std::array<int, maxNumSegments> offsets {};
+
+  while (offset < length) {
+    jassert(kernel->numSegments < maxNumSegments);
+
+    auto isLastSegment = uniform || partitionSize == largestPartitionSize;
+    auto end = isLastSegment ? length
+                             : std::min(length, partitionSize * partitionGrowth);
+
+    auto& segment = kernel->segments[static_cast<size_t>(kernel->numSegments)];
+    segment.partitionSize = partitionSize;
+    segment.numPartitions = (end - offset + partitionSize - 1) / partitionSize;
+    segment.spectrumSize = getSpectrumSize(partitionSize);
+    segment.fft = std::make_unique<juce::dsp::FFT>(getFFTOrder(2 * partitionSize));
+
+    offsets[static_cast<size_t>(kernel->numSegments)] = offset;
+    ++kernel->numSegments;
+
+    offset += segment.numPartitions * partitionSize;
+    partitionSize *= partitionGrowth;
+  }
+
+  // The segments transform their last 2N samples of input, so the history
+  // has to hold two of the longest partitions
+  auto longestPartitionSize = kernel->headSize;
+
+  for (int s = 0; s < kernel->numSegments; ++s) {
+    longestPartitionSize = std::max(longestPartitionSize,
+                                    kernel->segments[static_cast<size_t>(s)].partitionSize);
+  }
+
+  auto historySize = PowerOfTwoDelayLine::getRequiredSize(
+      static_cast<float>(2 * longestPartitionSize));
+  auto fftBufferSize = static_cast<size_t>(4 * longestPartitionSize);
+
+  // Size the kernel's memory, then take it in the same order
+  auto memorySize = AlignedArena::getAllocationSize<float>(fftBufferSize);
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    memorySize += AlignedArena::getAllocationSize<float>(static_cast<size_t>(kernel->headSize)) +
+                  AlignedArena::getAllocationSize<float>(static_cast<size_t>(2 * kernel->headSize)) +
+                  AlignedArena::getAllocationSize<float>(static_cast<size_t>(historySize));
+  }
+
+  for (int s = 0; s < kernel->numSegments; ++s) {
+    auto& segment = kernel->segments[static_cast<size_t>(s)];
+    auto spectraSize = static_cast<size_t>(segment.numPartitions * 2 * segment.spectrumSize);
+
+    memorySize += static_cast<size_t>(numChannels) *
+                  (2 * AlignedArena::getAllocationSize<float>(spectraSize) +
+                   AlignedArena::getAllocationSize<float>(static_cast<size_t>(2 * segment.spectrumSize)) +
+                   AlignedArena::getAllocationSize<float>(static_cast<size_t>(segment.partitionSize)));
+  }
+
+  kernel->memory.reset(memorySize);
+  kernel->fftBuffer = kernel->memory.allocate<float>(fftBufferSize);
+
+  for (size_t channel = 0; channel < static_cast<size_t>(numChannels); ++channel) {
+    auto headSize = static_cast<size_t>(kernel->headSize);
+    kernel->heads[channel] = kernel->memory.allocate<float>(headSize);
+    kernel->headHistories[channel] = kernel->memory.allocate<float>(2 * headSize);
+    kernel->histories[channel].setMemory(
+        kernel->memory.allocate<float>(static_cast<size_t>(historySize)), historySize);
+
+    // The head is stored back to front, so each output is a dot product
+    // with the input running forwards
+    const auto* channelTaps = taps.getReadPointer(static_cast<int>(channel));
+    auto headLength = std::min(kernel->headSize, length);
+    std::reverse_copy(channelTaps, channelTaps + headLength,
+                      kernel->heads[channel] + (kernel->headSize - headLength));
+  }
+
+  for (int s = 0; s < kernel->numSegments; ++s) {
+    auto& segment = kernel->segments[static_cast<size_t>(s)];
+    auto partitionStride = 2 * segment.spectrumSize;
+    auto spectraSize = static_cast<size_t>(segment.numPartitions * partitionStride);
+
+    for (size_t channel = 0; channel < static_cast<size_t>(numChannels); ++channel) {
+      segment.filterSpectra[channel] = kernel->memory.allocate<float>(spectraSize);
+      segment.inputSpectra[channel] = kernel->memory.allocate<float>(spectraSize);
+      segment.accumulators[channel] = kernel->memory.allocate<float>(
+          static_cast<size_t>(partitionStride));
+      segment.outputs[channel] = kernel->memory.allocate<float>(
+          static_cast<size_t>(segment.partitionSize));
+
+      // Transform every partition, zero padded to the FFT length
+      const auto* channelTaps = taps.getReadPointer(static_cast<int>(channel));
+
+      for (int partition = 0; partition < segment.numPartitions; ++partition) {
+        auto first = offsets[static_cast<size_t>(s)] + partition * segment.partitionSize;
+        auto last = std::min(first + segment.partitionSize, length);
+
+        std::fill(kernel->fftBuffer, kernel->fftBuffer + fftBufferSize, 0.0f);
+        std::copy(channelTaps + first, channelTaps + last, kernel->fftBuffer);
+        segment.fft->performRealOnlyForwardTransform(kernel->fftBuffer, true);
+
+        splitSpectrum(kernel->fftBuffer,
+                      segment.filterSpectra[channel] + partition * partitionStride,
+                      segment.spectrumSize, segment.partitionSize + 1);
+      }
+    }
+  }
+
+  jassert(kernel->memory.getNumBytesUsed() == kernel->memory.getSize());
+  return kernel;
+}
+
+int ConvolutionEngine::getTailLength() const noexcept {
+  return current == nullptr ? 0 : current->length;
+}
+
+void ConvolutionEngine::reset() noexcept {
+  if (current == nullptr)
+    return;
+
+  auto& kernel = *current;
+
+  for (size_t channel = 0; channel < static_cast<size_t>(kernel.numChannels); ++channel) {
+    std::fill(kernel.headHistories[channel],
+              kernel.headHistories[channel] + 2 * kernel.headSize, 0.0f);
+    kernel.histories[channel].clear();
+
+    for (int s = 0; s < kernel.numSegments; ++s) {
+      auto& segment = kernel.segments[static_cast<size_t>(s)];
+      auto partitionStride = 2 * segment.spectrumSize;
+
+      std::fill(segment.inputSpectra[channel],
+                segment.inputSpectra[channel] + segment.numPartitions * partitionStride,
+                0.0f);
+      std::fill(segment.accumulators[channel],
+                segment.accumulators[channel] + partitionStride, 0.0f);
+      std::fill(segment.outputs[channel],
+                segment.outputs[channel] + segment.partitionSize, 0.0f);
+    }
+  }
+
+  for (int s = 0; s < kernel.numSegments; ++s) {
+    kernel.segments[static_cast<size_t>(s)].newestSpectrum = 0;
+    kernel.segments[static_cast<size_t>(s)].numPartitionsAccumulated = 0;
+  }
+
+  kernel.position = 0;
+}
+
+void ConvolutionEngine::process(const juce::AudioBuffer<float>& input,
+                                juce::AudioBuffer<float>& output) {
+  jassert(output.getNumChannels() == input.getNumChannels());
+  jassert(output.getNumSamples() >= input.getNumSamples());
+
+  auto numSamples = input.getNumSamples();
+
+  // Pick up a newly loaded impulse response, as long as the loading thread
+  // has freed the last one this replaced
+  if (retired.load(std::memory_order_acquire) == nullptr) {
+    if (auto* next = pending.exchange(nullptr, std::memory_order_acq_rel)) {
+      retired.store(current.release(), std::memory_order_release);
+      current.reset(next);
+    }
+  }
+
+  if (current == nullptr) {
+    for (int channel = 0; channel < output.getNumChannels(); ++channel) {
+      output.clear(channel, 0, numSamples);
+    }
+
+    return;
+  }
+
+  jassert(input.getNumChannels() == current->numChannels);
+  processKernel(*current, input.getArrayOfReadPointers(),
+                output.getArrayOfWritePointers(), numSamples);
+}
+
+void ConvolutionEngine::processKernel(Kernel& kernel, const float* const* input,
+                                      float* const* output,
+                                      int numSamples) noexcept {
+  const auto headSize = kernel.headSize;
+  const auto headMask = static_cast<unsigned int>(headSize - 1);
+
+  // Work in chunks that never cross the end of a head block. Every
+  // partition is a multiple of the head, so they never cross the end of
+  // any segment's block either
+  for (int start = 0; start < numSamples;) {
+    auto phase = static_cast<int>(kernel.position & headMask);
+    auto chunkSize = std::min(numSamples - start, headSize - phase);
+
+    for (size_t channel = 0; channel < static_cast<size_t>(kernel.numChannels); ++channel) {
+      const auto* channelInput = input[channel] + start;
+      auto* headHistory = kernel.headHistories[channel];
+      const auto* head = kernel.heads[channel];
+
+      // Store the input first, as the output may be written over it
+      std::copy(channelInput, channelInput + chunkSize, headHistory + headSize + phase);
+      kernel.histories[channel].writeBlock(channelInput, chunkSize);
+
+      // The head, one tap at a time across the whole chunk, so the loop
+      // runs over contiguous samples instead of summing along the taps
+      alignas(64) float chunkOutput[maxHeadSize];
+      std::fill(chunkOutput, chunkOutput + chunkSize, 0.0f);
+
+      for (int tap = 0; tap < headSize; ++tap) {
+        auto coefficient = head[tap];
+        const auto* window = headHistory + phase + 1 + tap;
+
+        for (int i = 0; i < chunkSize; ++i) {
+          chunkOutput[i] += coefficient * window[i];
+        }
+      }
+
+      // Then the block each segment worked out at the end of its last one
+      for (int s = 0; s < kernel.numSegments; ++s) {
+        const auto& segment = kernel.segments[static_cast<size_t>(s)];
+        auto segmentMask = static_cast<unsigned int>(segment.partitionSize - 1);
+        const auto* segmentOutput =
+            segment.outputs[channel] + (kernel.position & segmentMask);
+
+        for (int i = 0; i < chunkSize; ++i) {
+          chunkOutput[i] += segmentOutput[i];
+        }
+      }
+
+      std::copy(chunkOutput, chunkOutput + chunkSize, output[channel] + start);
+    }
+
+    kernel.position += static_cast<unsigned int>(chunkSize);
+
+    for (int s = 0; s < kernel.numSegments; ++s) {
+      processSegment(kernel, kernel.segments[static_cast<size_t>(s)]);
+    }
+
+    // Move a finished head block back to make room for the next one
+    if ((kernel.position & headMask) == 0) {
+      for (size_t channel = 0; channel < static_cast<size_t>(kernel.numChannels); ++channel) {
+        auto* headHistory = kernel.headHistories[channel];
+        std::copy(headHistory + headSize, headHistory + 2 * headSize, headHistory);
+      }
+    }
+
+    start += chunkSize;
+  }
+}
+
+void ConvolutionEngine::processSegment(Kernel& kernel, Segment& segment) noexcept {
+  const auto partitionSize = segment.partitionSize;
+  const auto numPartitions = segment.numPartitions;
+  const auto partitionStride = 2 * segment.spectrumSize;
+  const auto numKernelChannels = static_cast<size_t>(kernel.numChannels);
+
+  auto phase = static_cast<int>(kernel.position &
+                                static_cast<unsigned int>(partitionSize - 1));
+  auto isEndOfBlock = phase == 0;
+
+  // Every partition but the first is convolved with input that has already
+  // been transformed, so spread them out over the block in proportion to
+  // how much of it has come in. Partition k of the next output block takes
+  // the spectrum k - 1 blocks before the newest
+  auto target = isEndOfBlock ? numPartitions - 1
+                             : ((numPartitions - 1) * phase) / partitionSize;
+
+  for (auto partition = segment.numPartitionsAccumulated + 1; partition <= target;
+       ++partition) {
+    auto slot = (segment.newestSpectrum - (partition - 1) + numPartitions) % numPartitions;
+
+    for (size_t channel = 0; channel < numKernelChannels; ++channel) {
+      multiplyAccumulate(segment.accumulators[channel],
+                         segment.inputSpectra[channel] + slot * partitionStride,
+                         segment.filterSpectra[channel] + partition * partitionStride,
+                         segment.spectrumSize);
+    }
+  }
+
+  segment.numPartitionsAccumulated = target;
+
+  if (!isEndOfBlock)
+    return;
+
+  // A whole block has come in. Transform it along with the block before it,
+  // add it in with the first partition and bring the next output block back
+  // out. Overlap-save: only the second half of the result is kept
+  segment.newestSpectrum = (segment.newestSpectrum + 1) % numPartitions;
+  auto* fftBuffer = kernel.fftBuffer;
+
+  for (size_t channel = 0; channel < numKernelChannels; ++channel) {
+    auto* spectrum = segment.inputSpectra[channel] + segment.newestSpectrum * partitionStride;
+    auto* accumulator = segment.accumulators[channel];
+
+    kernel.histories[channel].readBlock(fftBuffer, 2 * partitionSize, 0);
+    segment.fft->performRealOnlyForwardTransform(fftBuffer, true);
+    splitSpectrum(fftBuffer, spectrum, segment.spectrumSize, partitionSize + 1);
+
+    multiplyAccumulate(accumulator, spectrum, segment.filterSpectra[channel],
+                       segment.spectrumSize);
+
+    interleaveSpectrum(accumulator, fftBuffer, segment.spectrumSize, partitionSize + 1);
+    segment.fft->performRealOnlyInverseTransform(fftBuffer);
+
+    std::copy(fftBuffer + partitionSize, fftBuffer + 2 * partitionSize,
+              segment.outputs[channel]);
+    std::fill(accumulator, accumulator + partitionStride, 0.0f);
+  }
+
+  segment.numPartitionsAccumulated = 0;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "PowerOfTwoDelayLine.h"
+#include "AlignedArena.h"
+#include <array>
+#include <atomic>
+#include <memory>
+
+/**
+ * Convolves the input with a recorded impulse response.
+ *
+ * The first taps of the impulse response are applied directly as an FIR
+ * filter, so the engine adds no latency. The rest are split into partitions
+ * that are convolved with FFTs, either all of one size or in segments whose
+ * partitions grow further into the tail:
+ *
+ *   head       64 taps, direct form
+ *   segment 0  partitions of 64 up to 512 samples in
+ *   segment 1  partitions of 512 up to 4096 samples in
+ *   segment 2  partitions of 4096 for the rest
+ *
+ * A segment's partitions start at least one partition length in, so each
+ * segment can transform a whole partition of input at a time and still have
+ * its output ready before it is due.
+ *
+ * Every segment keeps the spectra of its recent input blocks in a frequency
+ * domain delay line and multiply-accumulates them with the spectra of its
+ * partitions. The spectra are stored as separate real and imaginary runs, so
+ * the multiply-accumulate is a plain contiguous loop the compiler vectorises.
+ * Only the newest partition needs the block that has just come in; the older
+ * ones are accumulated a few at a time as the block fills, so the long
+ * segments don't do all of their work in one callback.
+ *
+ * Loading an impulse response and transforming its partitions happens on the
+ * calling thread, which must not be the audio thread. The result, with all of
+ * the state it is processed with, is handed to the audio thread through an
+ * atomic pointer, so process() never allocates, frees or waits on a lock.
+ */
+class ConvolutionEngine {
+public:
+  static constexpr int maxNumChannels = 2;
+
+  // How far the output may be from a direct convolution with the scaled
+  // impulse response, for input in [-1, 1]
+  static constexpr float maxError = 2e-5f;
+
+  enum class Partitioning {
+    uniform,    // every partition is the same size
+    nonUniform  // partitions grow further into the tail
+  };
+
+  ConvolutionEngine();
+  ~ConvolutionEngine();
+
+  // How the next impulse response loaded is partitioned
+  void setPartitioning(Partitioning newPartitioning);
+
+  // Replaces the impulse response. It is resampled to the engine's sample
+  // rate, scaled to unit energy and transformed here, so this must be called
+  // from the message thread or a background thread, never the audio thread.
+  // A mono impulse response is used for every channel
+  void loadImpulseResponse(juce::AudioBuffer<float> newImpulseResponse,
+                           double newImpulseResponseSampleRate);
+
+  // Builds the engine for the current impulse response straight away. Must
+  // not be called while process() may be running
+  void prepare(float samplingRate, int numChannels);
+  void reset() noexcept;
+
+  // Writes the convolved input to the output, which may be the same buffer.
+  // Outputs silence until an impulse response has been loaded
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output);
+
+  Partitioning getPartitioning() const noexcept { return partitioning; }
+
+  // The length of the impulse response last loaded. Safe to call from any
+  // thread, including while another is loading an impulse response
+  double getImpulseResponseLengthSeconds() const noexcept {
+    return impulseResponseLengthSeconds.load(std::memory_order_relaxed);
+  }
+
+  // The number of samples of input the output still depends on, from the
+  // audio thread. After that many silent samples the engine only outputs
+  // silence
+  int getTailLength() const noexcept;
+
+private:
+  static constexpr int maxNumSegments = 3;
+
+  // One run of equally sized partitions and everything it is processed with
+  struct Segment {
+    int partitionSize = 0;  // N. The FFTs are 2N long
+    int numPartitions = 0;
+    int spectrumSize = 0;   // floats in each real or imaginary run
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+
+    // The partitions' spectra and the input's spectra for every channel,
+    // each one a real run followed by an imaginary run
+    std::array<float*, maxNumChannels> filterSpectra {};
+    std::array<float*, maxNumChannels> inputSpectra {};
+    std::array<float*, maxNumChannels> accumulators {};
+
+    // The N samples of output the segment plays over the current block
+    std::array<float*, maxNumChannels> outputs {};
+
+    int newestSpectrum = 0;             // slot of the last block transformed
+    int numPartitionsAccumulated = 0;   // older partitions done this block
+  };
+
+  // An impulse response ready to be processed, with all of its state
+  struct Kernel {
+    int numChannels = 0;
+    int length = 0;  // taps in the resampled impulse response
+    int headSize = 0;
+    int numSegments = 0;
+
+    std::array<float*, maxNumChannels> heads {};  // head taps, reversed
+
+    // The last headSize samples before the current head block, followed
+    // by the current one
+    std::array<float*, maxNumChannels> headHistories {};
+
+    // The input the segments transform their blocks from
+    std::array<PowerOfTwoDelayLine, maxNumChannels> histories;
+
+    std::array<Segment, maxNumSegments> segments;
+    float* fftBuffer = nullptr;  // room for the longest FFT
+
+    unsigned int position = 0;  // samples processed since the last reset
+
+    AlignedArena memory;
+  };
+
+  std::unique_ptr<Kernel> createKernel() const;
+  void processKernel(Kernel& kernel, const float* const* input,
+                     float* const* output, int numSamples) noexcept;
+  void processSegment(Kernel& kernel, Segment& segment) noexcept;
+
+  // Hands a kernel to the audio thread and frees one it has finished with
+  void publish(std::unique_ptr<Kernel> kernel);
+  void releaseRetiredKernel();
+
+  // Only touched by the thread that loads impulse responses
+  juce::AudioBuffer<float> impulseResponse;
+  double impulseResponseSampleRate = 0.0;
+  Partitioning partitioning = Partitioning::nonUniform;
+  float sampleRate = 0.0f;  // sample rate in Hz, 0 until prepared
+  int numChannels = 0;      // channels the engine was prepared for
+
+  // Worked out when an impulse response is loaded, for other threads to read
+  std::atomic<double> impulseResponseLengthSeconds { 0.0 };
+
+  // The kernel process() runs, owned by the audio thread
+  std::unique_ptr<Kernel> current;
+
+  // A kernel waiting for the audio thread to pick it up, and the one it
+  // replaced, waiting for the loading thread to free it
+  std::atomic<Kernel*> pending { nullptr };
+  std::atomic<Kernel*> retired { nullptr };
+
+  JUCE_DECLARE_NON_COPYABLE(ConvolutionEngine)
+};
@@ -0,0 +1,71 @@
+#include "DeadlineMonitor.h"
+#include <algorithm>
+
+void DeadlineMonitor::prepare(double samplingRate) {
+  jassert(samplingRate > 0.0);
+  sampleRate = samplingRate;
+  reset();
+}
+
+void DeadlineMonitor::reset() noexcept {
+  clearHistory();
+  stepsDown.store(0, std::memory_order_relaxed);
+  load.store(0.0f, std::memory_order_relaxed);
+  numStepsDown.store(0, std::memory_order_relaxed);
+  numStepsUp.store(0, std::memory_order_relaxed);
+}
+
+void DeadlineMonitor::clearHistory() noexcept {
+  numLoads = 0;
+  nextLoad = 0;
+  headroomTime = 0.0;
+}
+
+void DeadlineMonitor::addBlock(double elapsedSeconds, int numSamples,
+                               int maxStepsDown) noexcept {
+  if (numSamples <= 0)
+    return;
+
+  auto blockSeconds = static_cast<double>(numSamples) / sampleRate;
+
+  loads[static_cast<size_t>(nextLoad)] = static_cast<float>(elapsedSeconds / blockSeconds);
+  nextLoad = (nextLoad + 1) % historySize;
+  numLoads = std::min(numLoads + 1, historySize);
+
+  // The chosen tier may have changed under us
+  auto steps = std::min(stepsDown.load(std::memory_order_relaxed), std::max(maxStepsDown, 0));
+
+  if (numLoads < minBlocksToDecide) {
+    stepsDown.store(steps, std::memory_order_relaxed);
+    return;
+  }
+
+  // A partial sort of a copy finds the percentile without disturbing the ring
+  std::copy(loads.begin(), loads.begin() + numLoads, sorted.begin());
+  auto rank = static_cast<int>(loadPercentile * static_cast<float>(numLoads - 1));
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.begin() + numLoads);
+  auto percentileLoad = sorted[static_cast<size_t>(rank)];
+  load.store(percentileLoad, std::memory_order_relaxed);
+
+  if (percentileLoad > stepDownLoad) {
+    headroomTime = 0.0;
+
+    if (steps < maxStepsDown) {
+      ++steps;
+      numStepsDown.fetch_add(1, std::memory_order_relaxed);
+      clearHistory();
+    }
+  } else if (percentileLoad < stepUpLoad && steps > 0) {
+    headroomTime += blockSeconds;
+
+    if (headroomTime >= stepUpHoldTime) {
+      --steps;
+      numStepsUp.fetch_add(1, std::memory_order_relaxed);
+      clearHistory();
+    }
+  } else {
+    headroomTime = 0.0;
+  }
+
+  stepsDown.store(steps, std::memory_order_relaxed);
+}
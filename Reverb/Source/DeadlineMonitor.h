@@ -0,0 +1,66 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+
+/**
+ * Watches how much of each block's real-time deadline the reverb uses, and
+ * decides when to drop to a cheaper quality tier and when to come back.
+ *
+ * Every block's processing time is divided by the block's length,
+ * numSamples / sampleRate, and the last historySize of those loads are
+ * kept. As soon as the loadPercentile of them goes over stepDownLoad the
+ * monitor steps down a tier, and once it has stayed under stepUpLoad for
+ * stepUpHoldTime it steps back up one. Each tier costs up to about twice
+ * the one below it, so stepping up at half the step-down load keeps the
+ * tiers from bouncing back and forth. The history is cleared after every
+ * step so the next decision is made on the new tier alone.
+ *
+ * addBlock() only touches fixed arrays, so it is safe on the audio thread.
+ * The load and how often it has stepped are kept in atomics so the message
+ * thread can read them as telemetry.
+ */
+class DeadlineMonitor {
+public:
+  static constexpr int historySize = 64;           // in blocks
+  static constexpr int minBlocksToDecide = 16;     // after a step or reset
+  static constexpr float loadPercentile = 0.9f;
+  static constexpr float stepDownLoad = 0.3f;      // of the deadline
+  static constexpr float stepUpLoad = 0.15f;       // of the deadline
+  static constexpr double stepUpHoldTime = 2.0;    // in seconds
+
+  void prepare(double samplingRate);
+  void reset() noexcept;
+
+  // Records a block that took elapsedSeconds to process. maxStepsDown is how
+  // many tiers there are below the one that was chosen
+  void addBlock(double elapsedSeconds, int numSamples, int maxStepsDown) noexcept;
+
+  // How many tiers below the chosen one to run
+  int getStepsDown() const noexcept { return stepsDown.load(std::memory_order_relaxed); }
+
+  // The percentile load of the blocks since the last step, as a fraction of
+  // the deadline
+  float getLoad() const noexcept { return load.load(std::memory_order_relaxed); }
+
+  // How many times it has stepped down and back up since prepare()
+  int getNumStepsDown() const noexcept { return numStepsDown.load(std::memory_order_relaxed); }
+  int getNumStepsUp() const noexcept { return numStepsUp.load(std::memory_order_relaxed); }
+
+private:
+  void clearHistory() noexcept;
+
+  double sampleRate = 44100.0;  // sample rate in Hz
+
+  std::array<float, historySize> loads {};   // a ring of the latest loads
+  std::array<float, historySize> sorted {};  // scratch for the percentile
+  int numLoads = 0;
+  int nextLoad = 0;
+  double headroomTime = 0.0;  // seconds the load has been under stepUpLoad
+
+  std::atomic<int> stepsDown { 0 };
+  std::atomic<float> load { 0.0f };
+  std::atomic<int> numStepsDown { 0 };
+  std::atomic<int> numStepsUp { 0 };
+};
@@ -0,0 +1,314 @@
+#include "FeedbackDelayNetwork.h"
+#include <cmath>
+
+namespace {
+// The lines are spread geometrically between these, then each is moved up
+// to a prime number of samples so no two share a common factor
+constexpr float shortestDelayTime = 23.0f;  // in ms
+constexpr float longestDelayTime = 61.0f;   // in ms
+
+bool isPrime(int value) {
+  if (value < 2)
+    return false;
+
+  for (int divisor = 2; divisor * divisor <= value; ++divisor) {
+    if (value % divisor == 0)
+      return false;
+  }
+
+  return true;
+}
+}
+
+void FeedbackDelayNetwork::setNumLines(int numberOfLines) {
+  jassert(numberOfLines == 8 || numberOfLines == 16);
+  numLines = numberOfLines;
+  updateDelays();
+}
+
+void FeedbackDelayNetwork::setSampleRate(float value) {
+  sampleRate = value;
+  updateDelays();
+}
+
+void FeedbackDelayNetwork::setMatrix(Matrix newMatrix) {
+  matrix = newMatrix;
+  updateGains();
+}
+
+void FeedbackDelayNetwork::setDecay(float decay) {
+  decayTime = decay;
+  updateGains();
+}
+
+void FeedbackDelayNetwork::updateDelays() {
+  auto shortestDelay = (shortestDelayTime / 1000.0f) * sampleRate;
+  auto ratio = longestDelayTime / shortestDelayTime;
+
+  for (int line = 0; line < numLines; ++line) {
+    auto position = static_cast<float>(line) / static_cast<float>(numLines - 1);
+    auto delay = static_cast<int>(shortestDelay * std::pow(ratio, position));
+
+    while (!isPrime(delay))
+      ++delay;
+
+    delays[static_cast<size_t>(line)] = delay;
+  }
+
+  gainCache.invalidate();
+
+  // With two channels each one feeds every other line and is tapped from
+  // the same lines, with a different sign pattern on the way out, so the
+  // two channels come out decorrelated
+  auto numOutputChannels = std::max(numChannels, 1);
+  auto outputScale = 1.0f / std::sqrt(static_cast<float>(numLines / numOutputChannels));
+
+  for (size_t line = 0; line < maxNumLines; ++line) {
+    lineChannels[line] = static_cast<int>(line) % numOutputChannels;
+    inputGains[line] = (line / 2) % 2 == 0 ? 1.0f : -1.0f;
+    outputGains[line] = (line / 4) % 2 == 0 ? outputScale : -outputScale;
+  }
+
+  updateGains();
+}
+
+void FeedbackDelayNetwork::updateGains() {
+  // The Hadamard butterfly leaves out the 1 / sqrt(N) that makes the matrix
+  // orthogonal, so it is folded into the gains instead
+  auto matrixScale = matrix == Matrix::hadamard
+                         ? 1.0f / std::sqrt(static_cast<float>(numLines))
+                         : 1.0f;
+
+  if (!gainCache.update({ decayTime, sampleRate, matrixScale }))
+    return;
+
+  std::array<float, maxNumLines> lineDelays {};
+  for (int line = 0; line < numLines; ++line) {
+    auto l = static_cast<size_t>(line);
+    lineDelays[l] = static_cast<float>(delays[l]);
+  }
+
+  // Same mapping from decay to gain as CombBank's feedback
+  computeDecayGains(lineDelays.data(), gains.data(), numLines, decayTime,
+                    sampleRate);
+
+  for (int line = 0; line < numLines; ++line) {
+    gains[static_cast<size_t>(line)] *= matrixScale;
+  }
+}
+
+size_t FeedbackDelayNetwork::getMemorySize() const {
+  size_t memorySize = AlignedArena::getAllocationSize<float>(
+      static_cast<size_t>(numLines * maxChunkSize));
+
+  for (int line = 0; line < numLines; ++line) {
+    memorySize += AlignedArena::getAllocationSize<float>(static_cast<size_t>(
+        PowerOfTwoDelayLine::getRequiredSize(
+            static_cast<float>(delays[static_cast<size_t>(line)]))));
+  }
+
+  return memorySize;
+}
+
+void FeedbackDelayNetwork::prepare(float samplingRate, int numberOfChannels,
+                                   AlignedArena& arena) {
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  numChannels = numberOfChannels;
+  setSampleRate(samplingRate);
+
+  // The arena hands the memory out already cleared
+  lineBlocks = arena.allocate<float>(static_cast<size_t>(numLines * maxChunkSize));
+
+  for (int line = 0; line < numLines; ++line) {
+    auto size = PowerOfTwoDelayLine::getRequiredSize(
+        static_cast<float>(delays[static_cast<size_t>(line)]));
+
+    lines[static_cast<size_t>(line)].setMemory(
+        arena.allocate<float>(static_cast<size_t>(size)), size);
+  }
+}
+
+void FeedbackDelayNetwork::reset() noexcept {
+  for (int line = 0; line < numLines; ++line) {
+    lines[static_cast<size_t>(line)].clear();
+  }
+}
+
+float FeedbackDelayNetwork::getPeakLevel() const noexcept {
+  float peak = 0.0f;
+
+  for (int line = 0; line < numLines; ++line) {
+    peak = std::max(peak, lines[static_cast<size_t>(line)].getPeakLevel());
+  }
+
+  return peak;
+}
+
+void FeedbackDelayNetwork::process(const juce::AudioBuffer<float>& input,
+                                   juce::AudioBuffer<float>& output) {
+  jassert(input.getNumChannels() == numChannels);
+  jassert(output.getNumChannels() == numChannels);
+  jassert(output.getNumSamples() >= input.getNumSamples());
+
+  auto* inputData = input.getArrayOfReadPointers();
+  auto* outputData = output.getArrayOfWritePointers();
+  auto numSamples = input.getNumSamples();
+
+  if (numLines == 8) {
+    if (matrix == Matrix::hadamard) {
+      processChunks<8, Matrix::hadamard>(inputData, outputData, numSamples);
+    } else {
+      processChunks<8, Matrix::householder>(inputData, outputData, numSamples);
+    }
+  } else {
+    if (matrix == Matrix::hadamard) {
+      processChunks<16, Matrix::hadamard>(inputData, outputData, numSamples);
+    } else {
+      processChunks<16, Matrix::householder>(inputData, outputData, numSamples);
+    }
+  }
+}
+
+template <int NumLines, FeedbackDelayNetwork::Matrix MatrixType>
+void FeedbackDelayNetwork::processChunks(const float* const* input,
+                                         float* const* output,
+                                         int numSamples) {
+  // Row l of the blocks holds a chunk of line l's samples
+  auto block = [this](int line) { return lineBlocks + line * maxChunkSize; };
+
+  int shortestDelay = delays[0];
+  for (int line = 1; line < NumLines; ++line) {
+    shortestDelay = std::min(shortestDelay, delays[static_cast<size_t>(line)]);
+  }
+
+  for (int start = 0; start < numSamples;) {
+    auto chunkSize = std::min({ numSamples - start, maxChunkSize, shortestDelay });
+
+    // Keep the input, as the output may be written over it
+    alignas(64) float chunkInput[maxNumChannels][maxChunkSize];
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      std::copy(input[channel] + start, input[channel] + start + chunkSize,
+                chunkInput[channel]);
+      std::fill(output[channel] + start, output[channel] + start + chunkSize,
+                0.0f);
+    }
+
+    // Read the delayed samples of every line, tap them into the output and
+    // scale them by the line's decay gain. The newest sample a chunk reads
+    // is delay - chunkSize old, so it was written before the chunk started
+    for (int line = 0; line < NumLines; ++line) {
+      auto l = static_cast<size_t>(line);
+      auto spans = lines[l].getReadSpans(delays[l] - chunkSize, chunkSize);
+      auto* channelOutput = output[lineChannels[l]] + start;
+      auto* row = block(line);
+      auto outputGain = outputGains[l];
+      auto gain = gains[l];
+
+      for (auto& span : { spans.first, spans.second }) {
+        for (int i = 0; i < span.size; ++i) {
+          auto delayed = span.data[i];
+          channelOutput[i] += outputGain * delayed;
+          row[i] = gain * delayed;
+        }
+
+        channelOutput += span.size;
+        row += span.size;
+      }
+    }
+
+    // Mix the lines through the feedback matrix
+    alignas(64) float reflection[maxChunkSize];
+
+    if constexpr (MatrixType == Matrix::hadamard) {
+      // Fast Walsh-Hadamard transform. Two of its passes of sums and
+      // differences are done at once where they fit, so each line is only
+      // read and written log4(N) times
+      int half = 1;
+
+      for (; half * 4 <= NumLines; half *= 4) {
+        for (int first = 0; first < NumLines; first += 4 * half) {
+          for (int line = first; line < first + half; ++line) {
+            auto* a = block(line);
+            auto* b = block(line + half);
+            auto* c = block(line + 2 * half);
+            auto* d = block(line + 3 * half);
+
+            for (int i = 0; i < chunkSize; ++i) {
+              auto sumAB = a[i] + b[i];
+              auto differenceAB = a[i] - b[i];
+              auto sumCD = c[i] + d[i];
+              auto differenceCD = c[i] - d[i];
+
+              a[i] = sumAB + sumCD;
+              b[i] = differenceAB + differenceCD;
+              c[i] = sumAB - sumCD;
+              d[i] = differenceAB - differenceCD;
+            }
+          }
+        }
+      }
+
+      for (; half < NumLines; half *= 2) {
+        for (int first = 0; first < NumLines; first += 2 * half) {
+          for (int line = first; line < first + half; ++line) {
+            auto* a = block(line);
+            auto* b = block(line + half);
+
+            for (int i = 0; i < chunkSize; ++i) {
+              auto sum = a[i] + b[i];
+              auto difference = a[i] - b[i];
+              a[i] = sum;
+              b[i] = difference;
+            }
+          }
+        }
+      }
+    } else {
+      // Householder reflection: I - (2 / N) * ones, i.e. subtract 2 / N of
+      // the sum of every line from each one. The subtraction is done below,
+      // on the way back into the lines
+      constexpr float scale = 2.0f / static_cast<float>(NumLines);
+      std::fill(reflection, reflection + chunkSize, 0.0f);
+
+      for (int line = 0; line < NumLines; ++line) {
+        auto* row = block(line);
+
+        for (int i = 0; i < chunkSize; ++i) {
+          reflection[i] += scale * row[i];
+        }
+      }
+    }
+
+    // Add the input and write the chunk straight back into every line
+    for (int line = 0; line < NumLines; ++line) {
+      auto l = static_cast<size_t>(line);
+      auto spans = lines[l].getWriteSpans(chunkSize);
+      const auto* row = block(line);
+      const auto* channelInput = chunkInput[lineChannels[l]];
+      const auto* lineReflection = reflection;
+      auto inputGain = inputGains[l];
+
+      for (auto& span : { spans.first, spans.second }) {
+        for (int i = 0; i < span.size; ++i) {
+          auto sample = row[i] + inputGain * channelInput[i];
+
+          if constexpr (MatrixType == Matrix::householder) {
+            sample -= lineReflection[i];
+          }
+
+          span.data[i] = sample;
+        }
+
+        row += span.size;
+        channelInput += span.size;
+        lineReflection += span.size;
+      }
+
+      lines[l].advance(chunkSize);
+    }
+
+    start += chunkSize;
+  }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "PowerOfTwoDelayLine.h"
+#include "AlignedArena.h"
+#include "Coefficients.h"
+#include <array>
+
+/**
+ * A feedback delay network for the late part of the reverb.
+ *
+ * 8 or 16 delay lines feed back into each other through an orthogonal
+ * matrix, which builds up echo density far faster than parallel combs do for
+ * the same number of lines. The matrix is either a Hadamard matrix, applied
+ * with the O(N log N) fast Walsh-Hadamard butterfly, or a Householder
+ * reflection, which only needs one sum across the lines.
+ *
+ * Each line gets the gain that decays its own length by 60 dB in the decay
+ * time, the same mapping the combs use, so every line dies away together.
+ *
+ * The network is processed in chunks no longer than its shortest delay.
+ * Within a chunk nothing a line reads depends on what the chunk writes, so
+ * every stage (the delay reads, the gains, the butterfly and the output
+ * taps) runs across a whole row of samples of one line at a time, straight
+ * out of and back into the delay lines' memory. That keeps every inner
+ * loop a plain contiguous loop the compiler vectorises, without any
+ * gathers.
+ */
+class FeedbackDelayNetwork {
+public:
+  static constexpr int maxNumLines = 16;
+  static constexpr int maxNumChannels = 2;
+
+  enum class Matrix { hadamard, householder };
+
+  // The number of lines and the sample rate decide how much memory the
+  // network needs, so they have to be set before prepare(). 8 or 16
+  void setNumLines(int numberOfLines);
+  void setSampleRate(float value);
+
+  void setMatrix(Matrix newMatrix);
+
+  // Sets the gain of every line from the time it should take to decay 60 dB
+  //  @param decay is the desired decay of the network in seconds
+  void setDecay(float decay);
+
+  // Bytes prepare() takes from the arena for the current lines
+  size_t getMemorySize() const;
+
+  // The delay lines are taken from the arena, which must outlive the network
+  void prepare(float samplingRate, int numChannels, AlignedArena& arena);
+  void reset() noexcept;
+
+  // The largest magnitude of anything in the network's delay lines
+  float getPeakLevel() const noexcept;
+
+  // Runs the input through the network and writes only its output. The two
+  // buffers may be the same
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output);
+
+  int getNumLines() const noexcept { return numLines; }
+  Matrix getMatrix() const noexcept { return matrix; }
+
+private:
+  // Longest run of samples each line works on at once
+  static constexpr int maxChunkSize = 256;
+
+  void updateDelays();
+  void updateGains();
+
+  template <int NumLines, Matrix MatrixType>
+  void processChunks(const float* const* input, float* const* output,
+                     int numSamples);
+
+  float sampleRate = 44100.0f;  // sample rate in Hz
+  float decayTime = 1.0f;       // decay in seconds the gains are set from
+  int numLines = 16;
+  int numChannels = 0;          // channels the network was prepared for
+  Matrix matrix = Matrix::hadamard;
+
+  std::array<int, maxNumLines> delays {};  // in samples
+  std::array<float, maxNumLines> gains {}; // decay gain, with the matrix scale
+
+  // The gains are only set again when one of these changes. The delays are
+  // covered by invalidating the cache whenever they are set
+  CoefficientCache<3> gainCache;  // decay, sample rate and matrix scale
+
+  // The channel each line is fed from and tapped to, and the gains it is
+  // fed and tapped with
+  std::array<int, maxNumLines> lineChannels {};
+  std::array<float, maxNumLines> inputGains {};
+  std::array<float, maxNumLines> outputGains {};
+
+  std::array<PowerOfTwoDelayLine, maxNumLines> lines;
+  float* lineBlocks = nullptr;  // a chunk of samples for every line
+};
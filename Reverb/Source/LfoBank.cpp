@@ -0,0 +1,126 @@
+#include "LfoBank.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// The most lines a block can be cut into, with one cut short at each end
+int getMaxNumLines(int maximumBlockSize) {
+  return maximumBlockSize / LfoBank::controlInterval + 2;
+}
+}
+
+size_t LfoBank::getMemorySize(int maximumBlockSize) {
+  return AlignedArena::getAllocationSize<float>(
+      static_cast<size_t>(getMaxNumLines(maximumBlockSize)) * 2 * numLanes);
+}
+
+void LfoBank::prepare(float samplingRate, int maximumBlockSize,
+                      AlignedArena& arena) {
+  jassert(samplingRate > 0.0f && maximumBlockSize > 0);
+
+  sampleRate = samplingRate;
+  maxBlockSize = maximumBlockSize;
+  lines = arena.allocate<float>(static_cast<size_t>(getMaxNumLines(maxBlockSize)) * 2 *
+                                numLanes);
+
+  depth.prepare(sampleRate, depthRampTime, maxBlockSize);
+
+  // The rates are spread evenly in pitch, so no two of them share a
+  // low common multiple. Worked out in double, so the step is as close to
+  // the rate as a float can get
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    auto position = static_cast<double>(lane) / static_cast<double>(numLanes - 1);
+    auto rate = minRate * std::pow(static_cast<double>(maxRate / minRate), position);
+    auto angle = juce::MathConstants<double>::twoPi * rate * controlInterval /
+                 static_cast<double>(sampleRate);
+
+    cosineStep[l] = static_cast<float>(std::cos(angle));
+    sineStep[l] = static_cast<float>(std::sin(angle));
+  }
+
+  reset();
+}
+
+void LfoBank::reset() noexcept {
+  // Starting phases a golden angle apart never line up
+  constexpr double goldenAngle = 2.399963229728653;
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    auto phase = goldenAngle * static_cast<double>(lane);
+    cosine[l] = static_cast<float>(std::cos(phase));
+    sine[l] = static_cast<float>(std::sin(phase));
+  }
+
+  // The first line starts from the initial phases
+  segmentPosition = controlInterval;
+}
+
+void LfoBank::setDepth(float samples) {
+  jassert(samples >= 0.0f);
+  depth.setTargetValue(samples);
+}
+
+void LfoBank::process(int numSamples, int numLanesInUse) noexcept {
+  jassert(numSamples <= maxBlockSize);
+  jassert(numLanesInUse > 0 && numLanesInUse <= numLanes && numLanesInUse % 4 == 0);
+
+  depth.render(numSamples);
+  auto* depths = depth.getValues();
+
+  for (int i = 0, line = 0; i < numSamples; ++line) {
+    if (segmentPosition == controlInterval)
+      startSegment(numLanesInUse);
+
+    auto length = std::min(numSamples - i, controlInterval - segmentPosition);
+    auto* values = lines + static_cast<size_t>(line) * 2 * numLanes;
+    auto* steps = values + numLanes;
+
+    if (line == 0)
+      firstLineLength = length;
+
+    // Sample k of a segment sits k + 1 steps along it, as the segment's
+    // start is the last sample of the one before
+    auto first = static_cast<float>(segmentPosition + 1);
+    auto last = static_cast<float>(segmentPosition + length);
+    auto firstDepth = depths[i];
+    auto lastDepth = depths[i + length - 1];
+    auto inverseLength = length > 1 ? 1.0f / static_cast<float>(length - 1) : 0.0f;
+
+    for (int lane = 0; lane < numLanesInUse; ++lane) {
+      auto l = static_cast<size_t>(lane);
+      auto firstOffset = firstDepth * (segmentValue[l] + first * segmentSlope[l]);
+      auto lastOffset = lastDepth * (segmentValue[l] + last * segmentSlope[l]);
+      values[lane] = firstOffset;
+      steps[lane] = (lastOffset - firstOffset) * inverseLength;
+    }
+
+    segmentPosition += length;
+    i += length;
+  }
+}
+
+void LfoBank::startSegment(int numLanesInUse) noexcept {
+  constexpr float inverseInterval = 1.0f / static_cast<float>(controlInterval);
+
+  for (int lane = 0; lane < numLanesInUse; ++lane) {
+    auto l = static_cast<size_t>(lane);
+    auto rotatedCosine = cosine[l] * cosineStep[l] - sine[l] * sineStep[l];
+    auto rotatedSine = sine[l] * cosineStep[l] + cosine[l] * sineStep[l];
+
+    // One Newton step towards a length of one is plenty for the little a
+    // rotation's rounding moves it
+    auto correction =
+        1.5f - 0.5f * (rotatedCosine * rotatedCosine + rotatedSine * rotatedSine);
+    rotatedCosine *= correction;
+    rotatedSine *= correction;
+
+    segmentValue[l] = sine[l];
+    segmentSlope[l] = (rotatedSine - sine[l]) * inverseInterval;
+    cosine[l] = rotatedCosine;
+    sine[l] = rotatedSine;
+  }
+
+  segmentPosition = 0;
+}
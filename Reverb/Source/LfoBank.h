@@ -0,0 +1,98 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AlignedArena.h"
+#include "CombBank.h"
+#include "../../shared/ParameterRamp.h"
+#include <array>
+
+/**
+ * The sine LFOs that modulate a reverb's comb delays, one for each of a
+ * CombBank's lanes, all run together a block at a time.
+ *
+ * Each LFO is a phasor rotated by a fixed angle, which takes four
+ * multiplies and two adds and no sin() at all. The LFOs are so slow that
+ * the phasors are only rotated every controlInterval samples, and the
+ * samples in between are drawn in a straight line, which is within 1e-4 of
+ * a sample of the sine at the deepest modulation. Rounding makes a
+ * phasor's length drift a little, so it is pulled back to one at every
+ * rotation.
+ *
+ * process() doesn't write the offsets out sample by sample. It hands over
+ * just the lines, each as every lane's offset, in samples, at the line's
+ * first sample in the block and how far it moves per sample, which is the
+ * layout CombBank::setModulation() reads. The comb kernels step along them
+ * themselves, an add per lane and sample, so the offsets never go through
+ * memory. The rates are spread between minRate and maxRate so no two lanes
+ * move together.
+ *
+ * The depth is smoothed over depthRampTime so changing it doesn't make the
+ * delays jump. Each line runs between the offsets at the depths of its
+ * first and last samples, so where the ramp starts or stops partway along
+ * a line the corner is cut, by up to a sixth of a sample at the deepest
+ * modulation, and the delays still move without a jump. Once the depth has
+ * reached zero the bank stops, so the combs can go back to their
+ * unmodulated kernels.
+ */
+class LfoBank {
+public:
+  static constexpr int numLanes = CombBank::maxNumLanes;
+  static constexpr float minRate = 0.3f;          // in Hz
+  static constexpr float maxRate = 1.1f;          // in Hz
+  static constexpr double depthRampTime = 0.05;   // in seconds
+  static constexpr int controlInterval = 32;      // in samples
+
+  // Bytes prepare() takes from the arena
+  static size_t getMemorySize(int maximumBlockSize);
+
+  void prepare(float samplingRate, int maximumBlockSize, AlignedArena& arena);
+
+  // Starts every LFO from its initial phase again
+  void reset() noexcept;
+
+  // The largest offset from each delay, in samples. Ramped to
+  void setDepth(float samples);
+
+  // Whether the delays are being modulated at all, so whether process()
+  // needs calling
+  bool isActive() const noexcept {
+    return depth.getValue() != 0.0f || depth.getTargetValue() != 0.0f;
+  }
+
+  // Draws the lines of the first numLanesInUse lanes for the next
+  // numSamples samples. The rest of each row is left as it was, and the
+  // phasors of the lanes not in use don't move on
+  void process(int numSamples, int numLanesInUse) noexcept;
+
+  // The lines for the block just processed, two rows of maxNumLanes each,
+  // and how many samples the first one covers. Every line after it covers
+  // controlInterval samples, or up to the end of the block
+  const float* getLines() const noexcept { return lines; }
+  int getFirstLineLength() const noexcept { return firstLineLength; }
+
+private:
+  // Rotates the phasors on to the end of the next line and works out its
+  // slope
+  void startSegment(int numLanesInUse) noexcept;
+
+  float sampleRate = 44100.0f;  // sample rate in Hz
+  int maxBlockSize = 0;
+
+  ParameterRamp<float> depth;  // in samples
+
+  // Each lane's phasor at the end of the current line, and the rotation it
+  // takes every controlInterval samples
+  alignas(64) std::array<float, numLanes> cosine {};
+  alignas(64) std::array<float, numLanes> sine {};
+  alignas(64) std::array<float, numLanes> cosineStep {};
+  alignas(64) std::array<float, numLanes> sineStep {};
+
+  // Where every lane's sine starts the line to the next rotation, and how
+  // far it moves each sample
+  alignas(64) std::array<float, numLanes> segmentValue {};
+  alignas(64) std::array<float, numLanes> segmentSlope {};
+  int segmentPosition = 0;  // samples drawn along the current line
+
+  float* lines = nullptr;  // two rows of numLanes a line, from the arena
+  int firstLineLength = 0;
+};
@@ -0,0 +1,168 @@
+#include "MultichannelReverb.h"
+#include <algorithm>
+
+void MultichannelReverb::setMix(float value) {
+  mix = value;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setMix(mix);
+  }
+}
+
+void MultichannelReverb::setDecay(float value) {
+  decay = value;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setDecay(decay);
+  }
+}
+
+void MultichannelReverb::setRoomSize(float value) {
+  roomSize = value;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setRoomSize(roomSize);
+  }
+}
+
+void MultichannelReverb::setModulation(float value) {
+  modulation = value;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setModulation(modulation);
+  }
+}
+
+void MultichannelReverb::setDamping(float value) {
+  damping = value;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setDamping(damping);
+  }
+}
+
+void MultichannelReverb::setEngine(Reverb::Engine newEngine) {
+  engine = newEngine;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setEngine(engine);
+  }
+}
+
+void MultichannelReverb::setQuality(Reverb::Quality newQuality) {
+  quality = newQuality;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setQuality(quality);
+  }
+}
+
+void MultichannelReverb::setStereoSpread(int samples) {
+  stereoSpread = samples;
+
+  for (int group = 0; group < numGroups; ++group) {
+    groups[static_cast<size_t>(group)].setStereoSpread(stereoSpread);
+  }
+}
+
+void MultichannelReverb::loadImpulseResponse(
+    const juce::AudioBuffer<float>& newImpulseResponse,
+    double newImpulseResponseSampleRate) {
+  impulseResponse.makeCopyOf(newImpulseResponse);
+  impulseResponseSampleRate = newImpulseResponseSampleRate;
+  ++impulseResponseVersion;
+
+  // Groups that aren't in use are given it if they are prepared again
+  for (int group = 0; group < numGroups; ++group) {
+    auto g = static_cast<size_t>(group);
+    groups[g].loadImpulseResponse(impulseResponse, impulseResponseSampleRate);
+    loadedImpulseResponseVersions[g] = impulseResponseVersion;
+  }
+}
+
+bool MultichannelReverb::loadTopology(const juce::ValueTree& newTopology) {
+  // Every group checks the topology the same way, so the first says for all
+  if (!groups[0].loadTopology(newTopology))
+    return false;
+
+  topology = newTopology.createCopy();
+  ++topologyVersion;
+  loadedTopologyVersions[0] = topologyVersion;
+
+  for (int group = 1; group < numGroups; ++group) {
+    auto g = static_cast<size_t>(group);
+    groups[g].loadTopology(topology);
+    loadedTopologyVersions[g] = topologyVersion;
+  }
+
+  return true;
+}
+
+void MultichannelReverb::prepare(float samplingRate, int maximumBlockSize,
+                                 int numberOfChannels) {
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  numChannels = numberOfChannels;
+  numGroups = getNumGroups(numChannels);
+
+  for (int group = 0; group < numGroups; ++group) {
+    auto g = static_cast<size_t>(group);
+    auto groupChannels = std::min(2, numChannels - 2 * group);
+
+    if (loadedImpulseResponseVersions[g] != impulseResponseVersion) {
+      groups[g].loadImpulseResponse(impulseResponse, impulseResponseSampleRate);
+      loadedImpulseResponseVersions[g] = impulseResponseVersion;
+    }
+
+    if (loadedTopologyVersions[g] != topologyVersion) {
+      groups[g].loadTopology(topology);
+      loadedTopologyVersions[g] = topologyVersion;
+    }
+
+    groups[g].setMultirateEnabled(multirateEnabled);
+    groups[g].setSendModeEnabled(sendModeEnabled);
+    groups[g].prepare(samplingRate, maximumBlockSize, groupChannels);
+
+    // prepare() puts a group back to its defaults
+    groups[g].setMix(mix);
+    groups[g].setDecay(decay);
+    groups[g].setRoomSize(roomSize);
+    groups[g].setModulation(modulation);
+    groups[g].setDamping(damping);
+    groups[g].setEngine(engine);
+    groups[g].setQuality(quality);
+    groups[g].setStereoSpread(stereoSpread);
+  }
+
+  // The audio thread runs a group itself, so one worker fewer than there are
+  // groups keeps every group busy, without taking more cores than there are
+  auto numWorkers = std::min({ numGroups - 1, WorkerPool::maxNumWorkers,
+                               juce::SystemStats::getNumCpus() - 1 });
+  workers.start(std::max(numWorkers, 0), maximumBlockSize,
+                static_cast<double>(samplingRate));
+}
+
+double MultichannelReverb::getTailLengthSeconds(Reverb::Engine forEngine,
+                                                float forDecay) const {
+  // Every group has the same impulse response and settings
+  return groups[0].getTailLengthSeconds(forEngine, forDecay);
+}
+
+void MultichannelReverb::process(juce::AudioBuffer<float>& buffer) {
+  auto bufferChannels = buffer.getNumChannels();
+  auto numSamples = buffer.getNumSamples();
+  jassert(bufferChannels <= numChannels);
+
+  // Each task wraps its group's channels in a buffer of their own. A view
+  // onto existing channels doesn't allocate
+  auto processGroup = [this, &buffer, bufferChannels, numSamples](int group) {
+    auto firstChannel = 2 * group;
+    auto groupChannels = std::min(2, bufferChannels - firstChannel);
+
+    juce::AudioBuffer<float> groupBuffer(
+        buffer.getArrayOfWritePointers() + firstChannel, groupChannels, numSamples);
+    groups[static_cast<size_t>(group)].process(groupBuffer);
+  };
+
+  workers.run(getNumGroups(bufferChannels), processGroup);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "Reverb.h"
+#include "WorkerPool.h"
+#include <array>
+
+/**
+ * Runs a Reverb on layouts of up to 16 channels, such as 7.1.4.
+ *
+ * The channels are split into groups of neighbouring pairs, with a mono
+ * group at the end of an odd layout, and each group gets a Reverb of its
+ * own. Every group's state is allocated in prepare() for the layout being
+ * played, and the groups don't share anything while processing, so they
+ * are run in parallel on a small WorkerPool alongside the audio thread.
+ *
+ * The setters are passed on to every group, so all of them follow the same
+ * parameters, and are kept for any group prepared later.
+ */
+class MultichannelReverb {
+public:
+  static constexpr int maxNumChannels = 16;
+  static constexpr int maxNumGroups = maxNumChannels / 2;
+
+  void setMix(float value);
+  void setDecay(float value);
+  void setRoomSize(float value);
+  void setModulation(float value);
+  void setDamping(float value);
+  void setEngine(Reverb::Engine newEngine);
+  void setQuality(Reverb::Quality newQuality);
+  void setStereoSpread(int samples);
+
+  // See Reverb::setMultirateEnabled(). Takes effect at the next prepare()
+  void setMultirateEnabled(bool shouldBeEnabled) { multirateEnabled = shouldBeEnabled; }
+
+  // See Reverb::setSendModeEnabled(). Takes effect at the next prepare()
+  void setSendModeEnabled(bool shouldBeEnabled) { sendModeEnabled = shouldBeEnabled; }
+
+  // Passes an impulse response to every group. Never call this from the
+  // audio thread
+  void loadImpulseResponse(const juce::AudioBuffer<float>& newImpulseResponse,
+                           double newImpulseResponseSampleRate);
+
+  // Passes a topology to every group. Returns false if it isn't a valid one.
+  // Never call this from the audio thread
+  bool loadTopology(const juce::ValueTree& newTopology);
+
+  // Prepares a group for every pair of channels and starts enough workers to
+  // run them in parallel. Never call this from the audio thread
+  void prepare(float samplingRate, int maximumBlockSize, int numChannels);
+
+  void process(juce::AudioBuffer<float>& buffer);
+
+  // See Reverb::getTailLengthSeconds()
+  double getTailLengthSeconds(Reverb::Engine forEngine, float forDecay) const;
+
+  // See Reverb::getLatencySamples(). Every group lags by the same amount
+  int getLatencySamples() const noexcept { return groups[0].getLatencySamples(); }
+
+  int getNumGroups() const noexcept { return numGroups; }
+
+private:
+  static int getNumGroups(int numChannels) noexcept { return (numChannels + 1) / 2; }
+
+  int numChannels = 0;  // channels the groups were prepared for
+  int numGroups = 0;
+
+  // The settings every group is given, starting from Reverb's defaults
+  float mix = 0.8f;
+  float decay = 2.5f;
+  float roomSize = 1.0f;
+  float modulation = 0.0f;
+  float damping = 0.0f;
+  Reverb::Engine engine = Reverb::Engine::schroeder;
+  Reverb::Quality quality = Reverb::Quality::standard;
+  int stereoSpread = 23;  // in samples
+  bool multirateEnabled = false;
+  bool sendModeEnabled = false;
+
+  std::array<Reverb, maxNumGroups> groups;
+
+  // The impulse response is kept so groups prepared later can be given it
+  juce::AudioBuffer<float> impulseResponse;
+  double impulseResponseSampleRate = 0.0;
+  int impulseResponseVersion = 0;  // bumped by every load
+  std::array<int, maxNumGroups> loadedImpulseResponseVersions {};
+
+  // And so is the topology
+  juce::ValueTree topology;
+  int topologyVersion = 0;  // bumped by every load
+  std::array<int, maxNumGroups> loadedTopologyVersions {};
+
+  WorkerPool workers;
+};
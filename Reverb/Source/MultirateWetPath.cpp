@@ -0,0 +1,412 @@
+#include "MultirateWetPath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace {
+// The zeroth order modified Bessel function of the first kind, which the
+// Kaiser window is made of
+double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+
+  for (int k = 1; k < 50 && term > 1.0e-12 * sum; ++k) {
+    auto factor = x / (2.0 * k);
+    term *= factor * factor;
+    sum += term;
+  }
+
+  return sum;
+}
+}
+
+int MultirateWetPath::getFactorFor(float sampleRate) noexcept {
+  auto factor = 1;
+
+  while (factor < maxFactor && sampleRate / static_cast<float>(2 * factor) >= minNetworkSampleRate)
+    factor *= 2;
+
+  return factor;
+}
+
+void MultirateWetPath::designStage(Stage& stage, float inputSampleRate) {
+  // The band that folds onto the passband runs from the output's Nyquist
+  // frequency less the passband edge, so the transition is centred on a
+  // quarter of the input rate
+  auto transitionWidth = 0.5 - 2.0 * passbandEdge / inputSampleRate;
+  jassert(transitionWidth > 0.0);
+
+  // Kaiser's estimates of the length and shape for the attenuation
+  auto attenuation = static_cast<double>(stopbandAttenuation);
+  auto estimatedTaps = (attenuation - 7.95) / (14.36 * transitionWidth) + 1.0;
+  auto beta = 0.1102 * (attenuation - 8.7);
+
+  // A half-band filter has 4K - 1 taps, K of them nonzero either side of
+  // the centre
+  auto numCoefficients = static_cast<int>(std::ceil((estimatedTaps + 1.0) / 4.0));
+  numCoefficients = juce::jlimit(1, static_cast<int>(stage.coefficients.size()), numCoefficients);
+
+  stage.numCoefficients = numCoefficients;
+  stage.numTaps = 4 * numCoefficients - 1;
+  stage.centre = (stage.numTaps - 1) / 2;
+
+  // The windowed sinc with its cutoff at a quarter of the rate, scaled so
+  // its gain at DC is exactly 1
+  double sum = 0.0;
+  std::array<double, (maxNumTaps + 1) / 4> taps {};
+
+  for (int j = 0; j < numCoefficients; ++j) {
+    auto distance = static_cast<double>(2 * j + 1);
+    auto sign = j % 2 == 0 ? 1.0 : -1.0;
+    auto ratio = distance / static_cast<double>(stage.centre);
+    auto window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / besselI0(beta);
+
+    taps[static_cast<size_t>(j)] = sign / (juce::MathConstants<double>::pi * distance) * window;
+    sum += 2.0 * taps[static_cast<size_t>(j)];
+  }
+
+  for (int j = 0; j < numCoefficients; ++j) {
+    auto coefficient = static_cast<float>(taps[static_cast<size_t>(j)] * 0.5 / sum);
+    stage.coefficients[static_cast<size_t>(j)] = coefficient;
+    stage.doubledCoefficients[static_cast<size_t>(j)] = 2.0f * coefficient;
+  }
+}
+
+void MultirateWetPath::applyTaps(const float* coefficients, int numCoefficients,
+                                  float centreGain, const float* centres,
+                                  const float* pairs, float* out, int numOutputs) noexcept {
+  int o = 0;
+
+#if JUCE_INTEL
+  // Sixteen outputs at a time are summed over every tap in registers and
+  // stored once, rather than going back through memory for every tap
+  const auto gain = _mm_set1_ps(centreGain);
+
+  for (; o + 16 <= numOutputs; o += 16) {
+    auto sum0 = _mm_mul_ps(gain, _mm_loadu_ps(centres + o));
+    auto sum1 = _mm_mul_ps(gain, _mm_loadu_ps(centres + o + 4));
+    auto sum2 = _mm_mul_ps(gain, _mm_loadu_ps(centres + o + 8));
+    auto sum3 = _mm_mul_ps(gain, _mm_loadu_ps(centres + o + 12));
+
+    for (int j = 0; j < numCoefficients; ++j) {
+      const auto coefficient = _mm_set1_ps(coefficients[j]);
+      const auto* later = pairs + o + j;
+      const auto* earlier = pairs + o - 1 - j;
+
+      sum0 = _mm_add_ps(sum0, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(later),
+                                                                   _mm_loadu_ps(earlier))));
+      sum1 = _mm_add_ps(sum1, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(later + 4),
+                                                                   _mm_loadu_ps(earlier + 4))));
+      sum2 = _mm_add_ps(sum2, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(later + 8),
+                                                                   _mm_loadu_ps(earlier + 8))));
+      sum3 = _mm_add_ps(sum3, _mm_mul_ps(coefficient, _mm_add_ps(_mm_loadu_ps(later + 12),
+                                                                   _mm_loadu_ps(earlier + 12))));
+    }
+
+    _mm_storeu_ps(out + o, sum0);
+    _mm_storeu_ps(out + o + 4, sum1);
+    _mm_storeu_ps(out + o + 8, sum2);
+    _mm_storeu_ps(out + o + 12, sum3);
+  }
+#endif
+
+  for (; o < numOutputs; ++o) {
+    auto sum = centreGain * centres[o];
+
+    for (int j = 0; j < numCoefficients; ++j)
+      sum += coefficients[j] * (pairs[o + j] + pairs[o - 1 - j]);
+
+    out[o] = sum;
+  }
+}
+
+int MultirateWetPath::getNumOutputs(int phase, int numInputs) noexcept {
+  // Only the inputs with an even index overall are kept
+  return std::max(0, (numInputs + 1 - phase) / 2);
+}
+
+size_t MultirateWetPath::getMemorySize(float sampleRate, int factor,
+                                       int numChannels, int maxBlockSize) {
+  MultirateWetPath path;
+  path.setUp(factor, numChannels);
+  return path.layOut(sampleRate, maxBlockSize, nullptr);
+}
+
+void MultirateWetPath::prepare(float sampleRate, int newFactor,
+                               int numberOfChannels, int maxBlockSize,
+                               AlignedArena& arena) {
+  setUp(newFactor, numberOfChannels);
+  layOut(sampleRate, maxBlockSize, &arena);
+}
+
+void MultirateWetPath::setUp(int newFactor, int numberOfChannels) noexcept {
+  jassert(newFactor == 1 || newFactor == 2 || newFactor == 4);
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  factor = newFactor;
+  numChannels = numberOfChannels;
+  numStages = factor == 4 ? 2 : (factor == 2 ? 1 : 0);
+  latencySamples = 0;
+  numHeldOver = 0;
+}
+
+size_t MultirateWetPath::layOut(float sampleRate, int maxBlockSize,
+                                AlignedArena* arena) {
+  size_t size = 0;
+
+  // Counts a buffer of numFloats for every channel, and takes them from the
+  // arena if there is one
+  auto allocate = [this, arena, &size](std::array<float*, maxNumChannels>& buffers,
+                                       int numFloats) {
+    for (int channel = 0; channel < numChannels; ++channel) {
+      size += AlignedArena::getAllocationSize<float>(static_cast<size_t>(numFloats));
+
+      if (arena != nullptr)
+        buffers[static_cast<size_t>(channel)] = arena->allocate<float>(static_cast<size_t>(numFloats));
+    }
+  };
+
+  auto allocateOne = [arena, &size](float*& buffer, int numFloats) {
+    size += AlignedArena::getAllocationSize<float>(static_cast<size_t>(numFloats));
+
+    if (arena != nullptr)
+      buffer = arena->allocate<float>(static_cast<size_t>(numFloats));
+  };
+
+  if (numStages == 0)
+    return size;
+
+  auto maxNetworkSize = getMaxNetworkBlockSize(factor, maxBlockSize);
+
+  for (int s = 0; s < numStages; ++s) {
+    auto& stage = stages[static_cast<size_t>(s)];
+    designStage(stage, sampleRate / static_cast<float>(1 << s));
+
+    stage.maxInputSize = s == 0 ? maxBlockSize : (maxBlockSize + 1) / 2;
+    stage.maxInterpolatedSize = maxNetworkSize << (numStages - 1 - s);
+    stage.phase = 0;
+
+    allocate(stage.decimatorHistories, stage.numTaps - 1 + stage.maxInputSize);
+    allocate(stage.interpolatorHistories, stage.centre + stage.maxInterpolatedSize);
+
+    stage.phaseSize = std::max((stage.numTaps + stage.maxInputSize) / 2, stage.maxInterpolatedSize);
+    allocateOne(stage.centrePhase, stage.phaseSize);
+    allocateOne(stage.otherPhase, stage.phaseSize);
+
+    // Each stage delays by its centre tap on the way down and again on the
+    // way up, at its own input rate
+    latencySamples += (stage.numTaps - 1) << s;
+  }
+
+  if (numStages == 2)
+    allocate(halfRate, std::max((maxBlockSize + 1) / 2, 2 * maxNetworkSize));
+
+  auto interpolatedSize = factor * maxNetworkSize;
+  allocate(interpolated, interpolatedSize);
+
+  std::array<float*, maxNumChannels> holdoverMemory {};
+  std::array<float*, maxNumChannels> dryDelayMemory {};
+  auto holdoverSize = PowerOfTwoDelayLine::getRequiredSize(static_cast<float>(interpolatedSize + factor));
+  auto dryDelaySize = PowerOfTwoDelayLine::getRequiredSize(static_cast<float>(latencySamples + maxBlockSize));
+
+  allocate(holdoverMemory, holdoverSize);
+  allocate(dryDelayMemory, dryDelaySize);
+
+  if (arena != nullptr) {
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto c = static_cast<size_t>(channel);
+      holdovers[c].setMemory(holdoverMemory[c], holdoverSize);
+      dryDelays[c].setMemory(dryDelayMemory[c], dryDelaySize);
+    }
+  }
+
+  return size;
+}
+
+void MultirateWetPath::reset() noexcept {
+  for (int s = 0; s < numStages; ++s) {
+    auto& stage = stages[static_cast<size_t>(s)];
+    stage.phase = 0;
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto c = static_cast<size_t>(channel);
+      std::fill(stage.decimatorHistories[c],
+                stage.decimatorHistories[c] + stage.numTaps - 1 + stage.maxInputSize, 0.0f);
+      std::fill(stage.interpolatorHistories[c],
+                stage.interpolatorHistories[c] + stage.centre + stage.maxInterpolatedSize, 0.0f);
+    }
+  }
+
+  if (numStages == 0)
+    return;
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    holdovers[static_cast<size_t>(channel)].clear();
+    dryDelays[static_cast<size_t>(channel)].clear();
+  }
+
+  numHeldOver = 0;
+}
+
+int MultirateWetPath::getNumNetworkSamples(int numSamples) const noexcept {
+  for (int s = 0; s < numStages; ++s) {
+    numSamples = getNumOutputs(stages[static_cast<size_t>(s)].phase, numSamples);
+  }
+
+  return numSamples;
+}
+
+void MultirateWetPath::decimateStage(Stage& stage, const float* const* input,
+                                     float* const* output, int numInputs,
+                                     int numNetworkChannels) noexcept {
+  jassert(numInputs <= stage.maxInputSize);
+
+  const auto historySize = stage.numTaps - 1;
+  const auto numCoefficients = stage.numCoefficients;
+  const auto* coefficients = stage.coefficients.data();
+  const auto numOutputs = getNumOutputs(stage.phase, numInputs);
+  auto* centrePhase = stage.centrePhase;
+  auto* otherPhase = stage.otherPhase;
+
+  for (int channel = 0; channel < numNetworkChannels; ++channel) {
+    auto* history = stage.decimatorHistories[static_cast<size_t>(channel)];
+    auto* out = output[channel];
+    std::copy(input[channel], input[channel] + numInputs, history + historySize);
+
+    // Output o is centred on history[phase + 2o + 2K - 1], and its other
+    // taps fall on history[phase + 2t] for t either side of o + K
+    const auto* start = history + stage.phase;
+
+    for (int t = 0; t < numOutputs + 2 * numCoefficients - 1; ++t)
+      otherPhase[t] = start[2 * t];
+
+    for (int t = 0; t < numOutputs + numCoefficients - 1; ++t)
+      centrePhase[t] = start[2 * t + 1];
+
+    // The centre tap is 1/2 and the rest pair up either side of it
+    const auto* centres = centrePhase + numCoefficients - 1;
+
+    const auto* pairs = otherPhase + numCoefficients;
+    applyTaps(coefficients, numCoefficients, 0.5f, centres, pairs, out, numOutputs);
+
+    std::memmove(history, history + numInputs, static_cast<size_t>(historySize) * sizeof(float));
+  }
+
+  stage.phase = (stage.phase + numInputs) & 1;
+}
+
+void MultirateWetPath::interpolateStage(Stage& stage, const float* const* input,
+                                        float* const* output, int numInputs,
+                                        int numNetworkChannels) noexcept {
+  jassert(numInputs <= stage.maxInterpolatedSize);
+
+  const auto centre = stage.centre;
+  const auto numCoefficients = stage.numCoefficients;
+  const auto* doubledCoefficients = stage.doubledCoefficients.data();
+  auto* sums = stage.centrePhase;
+
+  for (int channel = 0; channel < numNetworkChannels; ++channel) {
+    auto* history = stage.interpolatorHistories[static_cast<size_t>(channel)];
+    auto* out = output[channel];
+    std::copy(input[channel], input[channel] + numInputs, history + centre);
+
+    // The even outputs see every other tap, doubled to make up for the
+    // zeros stuffed between the inputs
+    applyTaps(doubledCoefficients, numCoefficients, 0.0f, history, history + numCoefficients,
+              sums, numInputs);
+
+    // The odd outputs only see the centre tap, so they are the input
+    // delayed by K - 1
+    const auto* nearest = history + numCoefficients;
+
+    for (int i = 0; i < numInputs; ++i) {
+      out[2 * i] = sums[i];
+      out[2 * i + 1] = nearest[i];
+    }
+
+    std::memmove(history, history + numInputs, static_cast<size_t>(centre) * sizeof(float));
+  }
+}
+
+void MultirateWetPath::decimate(const juce::AudioBuffer<float>& input,
+                                juce::AudioBuffer<float>& network) {
+  jassert(numStages > 0 && input.getNumChannels() <= numChannels);
+  jassert(network.getNumChannels() == input.getNumChannels());
+  jassert(network.getNumSamples() == getNumNetworkSamples(input.getNumSamples()));
+
+  auto numInputs = input.getNumSamples();
+  auto numNetworkChannels = input.getNumChannels();
+
+  if (numStages == 1) {
+    decimateStage(stages[0], input.getArrayOfReadPointers(),
+                  network.getArrayOfWritePointers(), numInputs,
+                  numNetworkChannels);
+    return;
+  }
+
+  auto numHalfRate = getNumOutputs(stages[0].phase, numInputs);
+  decimateStage(stages[0], input.getArrayOfReadPointers(), halfRate.data(), numInputs,
+                numNetworkChannels);
+  decimateStage(stages[1], halfRate.data(), network.getArrayOfWritePointers(), numHalfRate,
+                numNetworkChannels);
+}
+
+void MultirateWetPath::interpolate(const juce::AudioBuffer<float>& network,
+                                   juce::AudioBuffer<float>& output) {
+  jassert(numStages > 0 && output.getNumChannels() <= numChannels);
+  jassert(network.getNumChannels() == output.getNumChannels());
+
+  auto numNetworkSamples = network.getNumSamples();
+  auto numSamples = output.getNumSamples();
+  auto numNetworkChannels = output.getNumChannels();
+  auto numInterpolated = factor * numNetworkSamples;
+
+  // With nothing held over and a block that's a multiple of the factor, as
+  // it usually is, the last stage can write straight into the output
+  auto direct = numHeldOver == 0 && numInterpolated == numSamples;
+  auto* const* destination = direct ? output.getArrayOfWritePointers() : interpolated.data();
+
+  if (numStages == 1) {
+    interpolateStage(stages[0], network.getArrayOfReadPointers(), destination,
+                     numNetworkSamples, numNetworkChannels);
+  } else {
+    interpolateStage(stages[1], network.getArrayOfReadPointers(), halfRate.data(),
+                     numNetworkSamples, numNetworkChannels);
+    interpolateStage(stages[0], halfRate.data(), destination, 2 * numNetworkSamples,
+                     numNetworkChannels);
+  }
+
+  if (direct)
+    return;
+
+  // The decimators keep every sample whose index is a multiple of the
+  // factor, so there are always at least as many interpolated samples as
+  // the block needs. The oldest go out now and the rest wait for the next
+  auto numAvailable = numHeldOver + numInterpolated;
+  jassert(numAvailable >= numSamples);
+
+  for (int channel = 0; channel < numNetworkChannels; ++channel) {
+    auto& holdover = holdovers[static_cast<size_t>(channel)];
+    holdover.writeBlock(interpolated[static_cast<size_t>(channel)], numInterpolated);
+    holdover.readBlock(output.getWritePointer(channel), numSamples, numAvailable - numSamples);
+  }
+
+  numHeldOver = numAvailable - numSamples;
+  jassert(numHeldOver < factor);
+}
+
+void MultirateWetPath::delayDry(juce::AudioBuffer<float>& buffer) {
+  jassert(numStages > 0 && buffer.getNumChannels() == numChannels);
+
+  auto numSamples = buffer.getNumSamples();
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    auto& delay = dryDelays[static_cast<size_t>(channel)];
+    delay.writeBlock(buffer.getReadPointer(channel), numSamples);
+    delay.readBlock(buffer.getWritePointer(channel), numSamples, latencySamples);
+  }
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "PowerOfTwoDelayLine.h"
+#include "AlignedArena.h"
+#include <array>
+
+/**
+ * Lets the reverb networks run at a half or a quarter of the sample rate.
+ *
+ * The input is decimated by 2 or 4 through a cascade of half-band FIR
+ * filters, the network processes that, and the same cascade interpolates
+ * its output back up before the mix. Every other tap of a half-band filter
+ * is zero apart from the centre one, so each stage is run in polyphase
+ * form: a decimator only works out the samples it keeps, and an
+ * interpolator's odd outputs are straight copies of its input.
+ *
+ * Each stage is a Kaiser windowed sinc that passes everything up to
+ * passbandEdge and keeps anything that would alias or image onto it
+ * stopbandAttenuation down, so only the band above 18 kHz, where a reverb
+ * tail has next to no energy, is lost. Keeping the transition that wide
+ * holds a stage to 10 nonzero taps either side of the centre at 96 kHz,
+ * where flat to 20 kHz at 80 dB would take 16. Every decimator and
+ * interpolator in the chain adds its ripple, so a sine in the passband
+ * comes back out within maxPassbandError.
+ *
+ * The filters are linear phase, so the wet path is late by a fixed number of
+ * samples, getLatencySamples(). delayDry() delays the dry signal by the same
+ * amount, so the two stay in line and the host can compensate for the lot.
+ *
+ * A block that isn't a multiple of the factor leaves the decimators part of
+ * the way through an output sample. The interpolators always produce a few
+ * samples more than the block has asked for, and those are held over for
+ * the next one.
+ */
+class MultirateWetPath {
+public:
+  static constexpr int maxNumChannels = 2;
+  static constexpr int maxFactor = 4;
+  static constexpr int maxNumTaps = 127;
+  static constexpr float passbandEdge = 18000.0f;       // in Hz
+  static constexpr float stopbandAttenuation = 70.0f;   // in dB
+  static constexpr float maxPassbandError = 2e-3f;
+  static constexpr float minNetworkSampleRate = 44100.0f;
+
+  // The largest of 1, 2 and 4 that keeps the network at or above
+  // minNetworkSampleRate
+  static int getFactorFor(float sampleRate) noexcept;
+
+  // Bytes prepare() takes from the arena
+  static size_t getMemorySize(float sampleRate, int factor, int numChannels,
+                              int maxBlockSize);
+
+  // The buffers are taken from the arena, which must outlive the path
+  void prepare(float sampleRate, int factor, int numChannels,
+               int maxBlockSize, AlignedArena& arena);
+  void reset() noexcept;
+
+  int getFactor() const noexcept { return factor; }
+
+  // The samples the wet path lags the input by, and so the dry path too
+  int getLatencySamples() const noexcept { return latencySamples; }
+
+  // The most samples the network is ever given in one block
+  static int getMaxNetworkBlockSize(int factor, int maxBlockSize) noexcept {
+    return (maxBlockSize + factor - 1) / factor;
+  }
+
+  // The number of samples decimate() will write for a block of numSamples
+  int getNumNetworkSamples(int numSamples) const noexcept;
+
+  // Decimates the input into the network buffer, which must hold
+  // getNumNetworkSamples() samples. The network may be given fewer channels
+  // than were prepared, as long as interpolate() is given the same number
+  void decimate(const juce::AudioBuffer<float>& input,
+                juce::AudioBuffer<float>& network);
+
+  // Interpolates what the network made of the last decimate() back up, into
+  // every sample of the output
+  void interpolate(const juce::AudioBuffer<float>& network,
+                   juce::AudioBuffer<float>& output);
+
+  // Delays the buffer in place by getLatencySamples()
+  void delayDry(juce::AudioBuffer<float>& buffer);
+
+private:
+  // One half-band filter, and the histories of its decimator and
+  // interpolator for every channel
+  struct Stage {
+    int numTaps = 0;  // N, 4K - 1
+    int centre = 0;   // (N - 1) / 2
+
+    // The nonzero taps either side of the centre, nearest first. The centre
+    // tap is 1/2
+    std::array<float, (maxNumTaps + 1) / 4> coefficients {};
+    int numCoefficients = 0;  // K
+
+    // The same, doubled, for the interpolator
+    std::array<float, (maxNumTaps + 1) / 4> doubledCoefficients {};
+
+    int maxInputSize = 0;          // the most samples decimated at once
+    int maxInterpolatedSize = 0;   // the most samples interpolated at once
+
+    // The last N - 1 input samples followed by the block being decimated
+    std::array<float*, maxNumChannels> decimatorHistories {};
+
+    // The last centre low rate samples followed by the block being
+    // interpolated
+    std::array<float*, maxNumChannels> interpolatorHistories {};
+
+    // Scratch for one channel at a time. The decimator splits its history
+    // into the samples in line with the centre tap and the ones between
+    // them, so every tap runs over a contiguous block of outputs. The
+    // interpolator sums its even outputs into the first
+    float* centrePhase = nullptr;
+    float* otherPhase = nullptr;
+    int phaseSize = 0;
+
+    int phase = 0;  // whether the next input sample is an odd one
+  };
+
+  void setUp(int newFactor, int numberOfChannels) noexcept;
+
+  // Designs the stages and works out the latency, and takes the buffers from
+  // the arena if there is one. Returns the bytes they take either way
+  size_t layOut(float sampleRate, int maxBlockSize, AlignedArena* arena);
+
+  static void designStage(Stage& stage, float inputSampleRate);
+  static int getNumOutputs(int phase, int numInputs) noexcept;
+
+  // Works out out[o] = centreGain * centres[o] plus, for each coefficient j,
+  // coefficients[j] * (pairs[o + j] + pairs[o - 1 - j])
+  static void applyTaps(const float* coefficients, int numCoefficients, float centreGain,
+                        const float* centres, const float* pairs, float* out,
+                        int numOutputs) noexcept;
+
+  void decimateStage(Stage& stage, const float* const* input, float* const* output,
+                     int numInputs, int numNetworkChannels) noexcept;
+  void interpolateStage(Stage& stage, const float* const* input, float* const* output,
+                        int numInputs, int numNetworkChannels) noexcept;
+
+  int factor = 1;
+  int numStages = 0;
+  int numChannels = 0;
+  int latencySamples = 0;
+
+  std::array<Stage, 2> stages;
+
+  // The half rate signal between two stages
+  std::array<float*, maxNumChannels> halfRate {};
+
+  // The interpolated output, before it goes into the holdover
+  std::array<float*, maxNumChannels> interpolated {};
+
+  // Interpolated samples not yet handed out
+  std::array<PowerOfTwoDelayLine, maxNumChannels> holdovers;
+  int numHeldOver = 0;
+
+  std::array<PowerOfTwoDelayLine, maxNumChannels> dryDelays;
+};
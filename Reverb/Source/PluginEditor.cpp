@@ -23,6 +23,80 @@ ReverbAudioProcessorEditor::ReverbAudioProcessorEditor (ReverbAudioProcessor& p,
     addAndMakeVisible(decayLabel);
     decayLabel.setText("DECAY", juce::dontSendNotification);
     decayLabel.attachToComponent(&decaySlider, false);
+
+    addAndMakeVisible(sizeSlider);
+    sizeSlider.setSliderStyle(juce::Slider::SliderStyle::LinearVertical);
+    sizeAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(valueTree, "size", sizeSlider));
+
+    addAndMakeVisible(sizeLabel);
+    sizeLabel.setText("SIZE", juce::dontSendNotification);
+    sizeLabel.attachToComponent(&sizeSlider, false);
+
+    addAndMakeVisible(modulationSlider);
+    modulationSlider.setSliderStyle(juce::Slider::SliderStyle::LinearVertical);
+    modulationAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(valueTree, "modulation", modulationSlider));
+
+    addAndMakeVisible(modulationLabel);
+    modulationLabel.setText("MOD", juce::dontSendNotification);
+    modulationLabel.attachToComponent(&modulationSlider, false);
+
+    addAndMakeVisible(dampingSlider);
+    dampingSlider.setSliderStyle(juce::Slider::SliderStyle::LinearVertical);
+    dampingAttachment.reset(new juce::AudioProcessorValueTreeState::SliderAttachment(valueTree, "damping", dampingSlider));
+
+    addAndMakeVisible(dampingLabel);
+    dampingLabel.setText("DAMP", juce::dontSendNotification);
+    dampingLabel.attachToComponent(&dampingSlider, false);
+
+    // The items have to be added before the attachment is made, so it can
+    // select the one that matches the parameter
+    addAndMakeVisible(engineBox);
+    engineBox.addItemList({ "Schroeder", "FDN", "Convolution", "Topology" }, 1);
+    engineAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(valueTree, "engine", engineBox));
+
+    addAndMakeVisible(engineLabel);
+    engineLabel.setText("ENGINE", juce::dontSendNotification);
+    engineLabel.attachToComponent(&engineBox, false);
+
+    addAndMakeVisible(qualityBox);
+    qualityBox.addItemList({ "Eco", "Standard", "High" }, 1);
+    qualityAttachment.reset(new juce::AudioProcessorValueTreeState::ComboBoxAttachment(valueTree, "quality", qualityBox));
+
+    addAndMakeVisible(qualityLabel);
+    qualityLabel.setText("QUALITY", juce::dontSendNotification);
+    qualityLabel.attachToComponent(&qualityBox, false);
+
+    addAndMakeVisible(deadlineLabel);
+    startTimerHz(4);
+
+    // The chooser has to outlive the call that launches it
+    addAndMakeVisible(loadImpulseResponseButton);
+    loadImpulseResponseButton.onClick = [this]
+    {
+        fileChooser = std::make_unique<juce::FileChooser>("Load an impulse response", juce::File(), "*.wav;*.aif;*.aiff;*.flac");
+        fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                 [this](const juce::FileChooser& chooser)
+                                 {
+                                     auto file = chooser.getResult();
+
+                                     if (file.existsAsFile())
+                                         audioProcessor.loadImpulseResponse(file);
+                                 });
+    };
+
+    addAndMakeVisible(loadTopologyButton);
+    loadTopologyButton.onClick = [this]
+    {
+        fileChooser = std::make_unique<juce::FileChooser>("Load a reverb topology", juce::File(), "*.xml");
+        fileChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                                 [this](const juce::FileChooser& chooser)
+                                 {
+                                     auto file = chooser.getResult();
+
+                                     if (file.existsAsFile())
+                                         audioProcessor.loadTopology(file);
+                                 });
+    };
 }
 
 ReverbAudioProcessorEditor::~ReverbAudioProcessorEditor()
@@ -47,4 +121,37 @@ void ReverbAudioProcessorEditor::resized()
     
     decaySlider.setBounds(area.removeFromLeft(sliderWidth));
     area.removeFromLeft(spacing);
+
+    sizeSlider.setBounds(area.removeFromLeft(sliderWidth));
+    area.removeFromLeft(spacing);
+
+    modulationSlider.setBounds(area.removeFromLeft(sliderWidth));
+    area.removeFromLeft(spacing);
+
+    dampingSlider.setBounds(area.removeFromLeft(sliderWidth));
+    area.removeFromLeft(spacing);
+
+    // The buttons load what the convolution and topology engines run, so
+    // they sit under the engine box rather than in a row of their own,
+    // which would be wider than the editor
+    auto engineArea = area.removeFromLeft(120);
+    engineBox.setBounds(engineArea.removeFromTop(24));
+    engineArea.removeFromTop(spacing);
+    loadImpulseResponseButton.setBounds(engineArea.removeFromTop(24));
+    engineArea.removeFromTop(spacing);
+    loadTopologyButton.setBounds(engineArea.removeFromTop(24));
+    area.removeFromLeft(spacing);
+
+    auto qualityArea = area.removeFromLeft(120);
+    qualityBox.setBounds(qualityArea.removeFromTop(24));
+    deadlineLabel.setBounds(qualityArea.removeFromTop(48));
+}
+
+void ReverbAudioProcessorEditor::timerCallback()
+{
+    const auto& monitor = audioProcessor.getDeadlineMonitor();
+    deadlineLabel.setText(juce::String(juce::roundToInt(monitor.getLoad() * 100.0f)) + "% LOAD\n"
+                              + juce::String(monitor.getNumStepsDown()) + " DOWN / "
+                              + juce::String(monitor.getNumStepsUp()) + " UP",
+                          juce::dontSendNotification);
 }
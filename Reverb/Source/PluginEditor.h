@@ -14,7 +14,8 @@
 //==============================================================================
 /**
 */
-class ReverbAudioProcessorEditor  : public juce::AudioProcessorEditor
+class ReverbAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                    private juce::Timer
 {
 public:
     ReverbAudioProcessorEditor (ReverbAudioProcessor&, juce::AudioProcessorValueTreeState& valueTree);
@@ -25,10 +26,40 @@ public:
     void resized() override;
 
 private:
-  
+    // Refreshes the deadline readout
+    void timerCallback() override;
+
     juce::Slider decaySlider;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> decayAttachment;
     juce::Label decayLabel;
+
+    juce::Slider sizeSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> sizeAttachment;
+    juce::Label sizeLabel;
+
+    juce::Slider modulationSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> modulationAttachment;
+    juce::Label modulationLabel;
+
+    juce::Slider dampingSlider;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> dampingAttachment;
+    juce::Label dampingLabel;
+
+    juce::ComboBox engineBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> engineAttachment;
+    juce::Label engineLabel;
+
+    juce::ComboBox qualityBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> qualityAttachment;
+    juce::Label qualityLabel;
+
+    // How much of each block's deadline is used, and how often the quality
+    // has been stepped down and back up
+    juce::Label deadlineLabel;
+
+    juce::TextButton loadImpulseResponseButton { "LOAD IR" };
+    juce::TextButton loadTopologyButton { "LOAD TOPOLOGY" };
+    std::unique_ptr<juce::FileChooser> fileChooser;
     
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
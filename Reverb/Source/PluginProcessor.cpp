@@ -13,6 +13,15 @@ juce::AudioProcessorValueTreeState::ParameterLayout ReverbAudioProcessor::create
 {
   return {
     std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "decay",  1 }, "Decay", juce::NormalisableRange{0.1f, 5.0f, 0.05f}, 2.5f),
+    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "size", 1 }, "Size", juce::NormalisableRange{Reverb::minRoomSize, CombBank::maxDelayScale, 0.01f}, 1.0f),
+    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "modulation", 1 }, "Modulation", juce::NormalisableRange{0.0f, 1.0f, 0.01f}, 0.0f),
+    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID { "damping", 1 }, "Damping", juce::NormalisableRange{0.0f, 1.0f, 0.01f}, 0.0f),
+    std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "engine", 1 }, "Engine", juce::StringArray { "Schroeder", "FDN", "Convolution", "Topology" }, 0),
+    std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "quality", 1 }, "Quality", juce::StringArray { "Eco", "Standard", "High" }, 1),
+    // These two change the reverb's latency or memory, so they're only read
+    // when the host prepares the plugin and can't be automated
+    std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "multirate", 1 }, "Multirate", false, juce::AudioParameterBoolAttributes().withAutomatable(false)),
+    std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "send", 1 }, "Send", false, juce::AudioParameterBoolAttributes().withAutomatable(false)),
   };
 }
 
@@ -31,6 +40,15 @@ ReverbAudioProcessor::ReverbAudioProcessor()
   , parameters(*this, nullptr, juce::Identifier("parameters"), createParameterLayout())
 {
   decayParameter = parameters.getRawParameterValue("decay");
+  sizeParameter = parameters.getRawParameterValue("size");
+  modulationParameter = parameters.getRawParameterValue("modulation");
+  dampingParameter = parameters.getRawParameterValue("damping");
+  engineParameter = parameters.getRawParameterValue("engine");
+  qualityParameter = parameters.getRawParameterValue("quality");
+  multirateParameter = parameters.getRawParameterValue("multirate");
+  sendParameter = parameters.getRawParameterValue("send");
+
+  formatManager.registerBasicFormats();
 }
 
 ReverbAudioProcessor::~ReverbAudioProcessor()
@@ -72,7 +90,9 @@ bool ReverbAudioProcessor::isMidiEffect() const
 
 double ReverbAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // Worked out from the parameters, as the host asks from the message thread
+    const auto engine = static_cast<int>(engineParameter->load());
+    return reverb.getTailLengthSeconds(static_cast<Reverb::Engine>(engine), decayParameter->load());
 }
 
 int ReverbAudioProcessor::getNumPrograms()
@@ -102,7 +122,22 @@ void ReverbAudioProcessor::changeProgramName (int index, const juce::String& new
 //==============================================================================
 void ReverbAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-  reverb.prepare(sampleRate);
+  // Switching multirate changes the latency, so it only takes effect here
+  reverb.setMultirateEnabled(multirateParameter->load() > 0.5f);
+
+  // On an aux send the return only carries the reverb, so it runs fully wet
+  // and the networks are only run once. This changes how much memory the
+  // reverb needs, so it only takes effect here too
+  const auto sendMode = sendParameter->load() > 0.5f;
+  reverb.setSendModeEnabled(sendMode);
+  reverb.setMix(sendMode ? 1.0f : 0.8f);
+  reverb.prepare(sampleRate, samplesPerBlock, getTotalNumOutputChannels());
+
+  // At high sample rates a multirate wet path is resampled, which delays
+  // everything
+  setLatencySamples(reverb.getLatencySamples());
+
+  deadlineMonitor.prepare(sampleRate);
 }
 
 void ReverbAudioProcessor::releaseResources()
@@ -118,12 +153,11 @@ bool ReverbAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Anything from mono up to 16 channels (e.g. 7.1.4) is supported, as
+    // the reverb runs each pair of channels on its own
+    auto numOutputChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numOutputChannels == 0 || numOutputChannels > MultichannelReverb::maxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -140,6 +174,7 @@ bool ReverbAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
 void ReverbAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    const auto startTicks = juce::Time::getHighResolutionTicks();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -154,7 +189,27 @@ void ReverbAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce:
 
     const auto decay = decayParameter->load();
     reverb.setDecay(decay);
+    reverb.setRoomSize(sizeParameter->load());
+    reverb.setModulation(modulationParameter->load());
+    reverb.setDamping(dampingParameter->load());
+
+    // The choices are in the same order as Reverb::Engine
+    const auto engine = static_cast<int>(engineParameter->load());
+    reverb.setEngine(static_cast<Reverb::Engine>(engine));
+
+    // And these are in the same order as Reverb::Quality. When the blocks
+    // are running close to their deadline the reverb drops below the chosen
+    // tier, but an offline render has all the time it needs
+    const auto quality = static_cast<int>(qualityParameter->load());
+    const auto stepsDown = isNonRealtime() ? 0 : deadlineMonitor.getStepsDown();
+    reverb.setQuality(static_cast<Reverb::Quality>(juce::jmax(0, quality - stepsDown)));
     reverb.process(buffer);
+
+    if (! isNonRealtime())
+    {
+        const auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        deadlineMonitor.addBlock(elapsed, buffer.getNumSamples(), quality);
+    }
 }
 
 //==============================================================================
@@ -182,6 +237,39 @@ void ReverbAudioProcessor::setStateInformation (const void* data, int sizeInByte
     // whose contents will have been created by the getStateInformation() call.
 }
 
+bool ReverbAudioProcessor::loadImpulseResponse (const juce::File& file)
+{
+  // Anything longer than this is cut off
+  constexpr double maxImpulseResponseLength = 10.0;  // in seconds
+
+  std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+  if (reader == nullptr || reader->lengthInSamples == 0)
+    return false;
+
+  auto numChannels = juce::jmin (static_cast<int> (reader->numChannels), 2);
+  auto numSamples = static_cast<int> (juce::jmin (reader->lengthInSamples,
+      static_cast<juce::int64> (reader->sampleRate * maxImpulseResponseLength)));
+
+  juce::AudioBuffer<float> impulseResponse (numChannels, numSamples);
+  reader->read (&impulseResponse, 0, numSamples, 0, true, numChannels > 1);
+
+  // The impulse response is transformed here, off the audio thread
+  reverb.loadImpulseResponse (impulseResponse, reader->sampleRate);
+  return true;
+}
+
+bool ReverbAudioProcessor::loadTopology (const juce::File& file)
+{
+  auto xml = juce::parseXML (file);
+
+  if (xml == nullptr)
+    return false;
+
+  // The topology is compiled here, off the audio thread
+  return reverb.loadTopology (juce::ValueTree::fromXml (*xml));
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -9,8 +9,8 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "Reverb.h"
-#include "CombFilter.h"
+#include "MultichannelReverb.h"
+#include "DeadlineMonitor.h"
 
 //==============================================================================
 /**
@@ -57,12 +57,36 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // Reads an impulse response file for the convolution engine. Called from
+    // the message thread. Returns false if the file couldn't be read
+    bool loadImpulseResponse (const juce::File& file);
+
+    // Reads a reverb topology from an XML file for the topology engine. See
+    // TopologyEngine for the format. Called from the message thread. Returns
+    // false if the file isn't a valid topology
+    bool loadTopology (const juce::File& file);
+
+    // How close processBlock() runs to its deadline, and how often the
+    // quality has been stepped down and back up because of it. Safe to read
+    // from the message thread
+    const DeadlineMonitor& getDeadlineMonitor() const noexcept { return deadlineMonitor; }
+
 private:
     
-  Reverb reverb;
+  MultichannelReverb reverb;
+  DeadlineMonitor deadlineMonitor;
   
   juce::AudioProcessorValueTreeState parameters;
   std::atomic<float>* decayParameter = nullptr;
+  std::atomic<float>* sizeParameter = nullptr;
+  std::atomic<float>* modulationParameter = nullptr;
+  std::atomic<float>* dampingParameter = nullptr;
+  std::atomic<float>* engineParameter = nullptr;
+  std::atomic<float>* qualityParameter = nullptr;
+  std::atomic<float>* multirateParameter = nullptr;
+  std::atomic<float>* sendParameter = nullptr;
+
+  juce::AudioFormatManager formatManager;
   
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ReverbAudioProcessor)
@@ -0,0 +1,75 @@
+#include "PowerOfTwoDelayLine.h"
+#include <algorithm>
+#include <cmath>
+
+int PowerOfTwoDelayLine::getRequiredSize(float delayTimeInSamples) {
+  // get() interpolates between the sample at the delay time and the one
+  // after it, so both of those need to still be in the buffer
+  auto minimumSize = static_cast<int>(std::floor(delayTimeInSamples)) + 2;
+  return juce::nextPowerOfTwo(minimumSize);
+}
+
+void PowerOfTwoDelayLine::setMemory(float* memory, int size) noexcept {
+  jassert(memory != nullptr && juce::isPowerOfTwo(size));
+
+  buffer = memory;
+  mask = static_cast<size_t>(size) - 1;
+  writeIndex = 0;
+}
+
+void PowerOfTwoDelayLine::clear() noexcept {
+  std::fill(buffer, buffer + getCapacity(), 0.0f);
+  writeIndex = 0;
+}
+
+float PowerOfTwoDelayLine::getPeakLevel() const noexcept {
+  if (buffer == nullptr)
+    return 0.0f;
+
+  auto range = juce::FloatVectorOperations::findMinAndMax(buffer, getCapacity());
+  return std::max(-range.getStart(), range.getEnd());
+}
+
+PowerOfTwoDelayLine::Spans<float>
+PowerOfTwoDelayLine::getWriteSpans(int numSamples) noexcept {
+  jassert(numSamples >= 0 && numSamples <= getCapacity());
+
+  auto firstSize = std::min(numSamples, getCapacity() - static_cast<int>(writeIndex));
+
+  return { { buffer + writeIndex, firstSize },
+           { buffer, numSamples - firstSize } };
+}
+
+PowerOfTwoDelayLine::Spans<const float>
+PowerOfTwoDelayLine::getReadSpans(int delayInSamples,
+                                  int numSamples) const noexcept {
+  // The oldest sample of the block must still be in the ring
+  jassert(delayInSamples >= 0 && numSamples >= 0);
+  jassert(delayInSamples + numSamples <= getCapacity());
+
+  auto startIndex = (writeIndex - static_cast<size_t>(delayInSamples + numSamples)) & mask;
+  auto firstSize = std::min(numSamples, getCapacity() - static_cast<int>(startIndex));
+
+  return { { buffer + startIndex, firstSize },
+           { buffer, numSamples - firstSize } };
+}
+
+void PowerOfTwoDelayLine::writeBlock(const float* source,
+                                     int numSamples) noexcept {
+  auto spans = getWriteSpans(numSamples);
+
+  std::copy(source, source + spans.first.size, spans.first.data);
+  std::copy(source + spans.first.size, source + numSamples, spans.second.data);
+
+  advance(numSamples);
+}
+
+void PowerOfTwoDelayLine::readBlock(float* destination, int numSamples,
+                                    int delayInSamples) const noexcept {
+  auto spans = getReadSpans(delayInSamples, numSamples);
+
+  std::copy(spans.first.data, spans.first.data + spans.first.size,
+            destination);
+  std::copy(spans.second.data, spans.second.data + spans.second.size,
+            destination + spans.first.size);
+}
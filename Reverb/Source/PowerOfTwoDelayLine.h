@@ -0,0 +1,108 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+/**
+ * A delay line whose capacity is rounded up to a power of two, so the read
+ * and write positions wrap with a bitmask instead of a modulo. push() and
+ * get() are defined here so they can be inlined into per-sample loops.
+ *
+ * Samples are written forwards and get(0) is the most recently pushed one.
+ *
+ * For a fixed delay, a whole block of samples sits in at most two contiguous
+ * runs of the ring. The block functions hand those runs out directly, so
+ * fixed delay stages can work on a block at a time with memcpy and vector
+ * arithmetic instead of per-sample index arithmetic.
+ *
+ * The delay line doesn't own its samples. It is a view onto memory handed
+ * to it by setMemory(), so the owner can keep every delay line it has in one
+ * block.
+ */
+class PowerOfTwoDelayLine {
+public:
+  // A contiguous run of the ring, oldest sample first
+  template <typename SampleType>
+  struct Span {
+    SampleType* data = nullptr;
+    int size = 0;
+  };
+
+  // The runs of the ring that a block of samples lives in, in time order.
+  // second is empty unless the block wraps round the end of the ring
+  template <typename SampleType>
+  struct Spans {
+    Span<SampleType> first;
+    Span<SampleType> second;
+  };
+
+  void push(float sample) noexcept {
+    buffer[writeIndex] = sample;
+    writeIndex = (writeIndex + 1) & mask;
+  }
+
+  // The number of samples a ring needs to hold a delay of delayTimeInSamples.
+  // Always a power of two
+  static int getRequiredSize(float delayTimeInSamples);
+
+  // Points the delay line at size samples of memory owned by the caller,
+  // which must outlive it. size must be a power of two
+  void setMemory(float* memory, int size) noexcept;
+  void clear() noexcept;
+
+  float get(float delayTimeInSamples) const noexcept {
+    jassert(delayTimeInSamples >= 0 && delayTimeInSamples < mask);
+
+    // The delay is never negative, so truncating is the same as std::floor
+    auto wholeSamples = static_cast<size_t>(delayTimeInSamples);
+    auto fraction = delayTimeInSamples - static_cast<float>(wholeSamples);
+
+    // The index arithmetic is unsigned, so it wraps round before the mask
+    auto leftSampleIndex = writeIndex - 1 - wholeSamples;
+    auto leftSample = buffer[leftSampleIndex & mask];
+    auto rightSample = buffer[(leftSampleIndex - 1) & mask];
+
+    // Linear interpolation
+    return leftSample + fraction * (rightSample - leftSample);
+  }
+
+  // Reads a whole number of samples back, without any interpolation
+  float get(int delayInSamples) const noexcept {
+    jassert(delayInSamples >= 0 && static_cast<size_t>(delayInSamples) < mask);
+
+    return buffer[(writeIndex - 1 - static_cast<size_t>(delayInSamples)) & mask];
+  }
+
+  // The samples the next numSamples pushes will write to
+  Spans<float> getWriteSpans(int numSamples) noexcept;
+
+  // Moves the write position past numSamples written through
+  // getWriteSpans(), as if they had been pushed
+  void advance(int numSamples) noexcept {
+    writeIndex = (writeIndex + static_cast<size_t>(numSamples)) & mask;
+  }
+
+  // The numSamples consecutive samples whose newest one is delayInSamples
+  // old, i.e. the last one is what get(delayInSamples) would return
+  Spans<const float> getReadSpans(int delayInSamples,
+                                  int numSamples) const noexcept;
+
+  // Pushes a whole block, oldest sample first
+  void writeBlock(const float* source, int numSamples) noexcept;
+
+  // Copies the samples described by getReadSpans() into destination
+  void readBlock(float* destination, int numSamples,
+                 int delayInSamples) const noexcept;
+
+  // The largest magnitude of any sample in the ring
+  float getPeakLevel() const noexcept;
+
+  // Number of samples the ring holds
+  int getCapacity() const noexcept {
+    return buffer == nullptr ? 0 : static_cast<int>(mask + 1);
+  }
+
+private:
+  float* buffer = nullptr;
+  size_t mask = 0;
+  size_t writeIndex = 0;
+};
@@ -1,9 +1,57 @@
 #include "Reverb.h"
+#include "CombBankKernels.h"
 #include <algorithm>
+#include <iterator>
+
+namespace {
+// How often a quiet reverb checks whether its tail has died away
+constexpr float tailCheckTime = 0.1f;  // in seconds
+
+// The Schroeder network's delays, in ms. Eco runs the combs and the first
+// all-pass, Standard adds the second all-pass, which makes the original
+// network, and High adds combs that fall in between and longer all-passes
+constexpr float combDelayTimes[] = { 30.1f, 34.2f, 39.1f, 45.1f };
+constexpr float allPassDelayTimes[] = { 1.2f };
+constexpr float standardAllPassDelayTimes[] = { 3.6f };
+constexpr float highCombDelayTimes[] = { 27.3f, 32.3f, 36.7f, 42.4f };
+constexpr float highAllPassDelayTimes[] = { 5.1f, 7.7f };
+
+// In send mode the side signal is the mono wet signal this much later. A
+// tail is only correlated with itself at lags near its comb delays, so it
+// sits well clear of them
+constexpr float sideDelayTime = 13.7f;  // in ms
+
+constexpr int numCombs = static_cast<int>(std::size(combDelayTimes));
+constexpr int numHighCombs = static_cast<int>(std::size(highCombDelayTimes));
+
+// Sets up a bank of combs with alternating signs
+void setUpCombs(CombBank& bank, const float* delayTimes, int numberOfCombs) {
+  for (int i = 0; i < numberOfCombs; i++) {
+    bank.setDelayTime(i, delayTimes[i]);
+    bank.setPhaseFlipped(i, i % 2 == 0);
+  }
+
+  // None of the delays are modulated, so round them all to whole samples
+  // and let every filter skip its interpolation
+  bank.setInterpolated(false);
+}
+
+// Sets up a chain of all-passes in series with a gain of 0.5
+template <size_t NumStages>
+void setUpAllPasses(AllPassChain& chain, const float (&delayTimes)[NumStages]) {
+  chain.setNumStages(static_cast<int>(NumStages));
+  chain.setTopology(AllPassChain::Topology::series);
+
+  for (size_t i = 0; i < NumStages; i++) {
+    chain.setDelayTime(static_cast<int>(i), delayTimes[i]);
+    chain.setFeedback(static_cast<int>(i), 0.5f);
+  }
+}
+}
 
 Reverb::Reverb() {
-  combFilters.resize(4);  // Initialize 4 comb filters
-  allPassFilters.resize(2);
+  // The topology engine plays the classic network until another is loaded
+  topologyEngine.loadTopology(TopologyEngine::createClassicTopology());
 }
 
 Reverb::~Reverb() {}
@@ -11,102 +59,639 @@ Reverb::~Reverb() {}
 void Reverb::setSampleRate(float value) {
   sampleRate = value;
 
+  // At high rates the networks run at a half or a quarter of it, which
+  // still leaves them everything up to 20 kHz
+  networkFactor = multirateEnabled ? MultirateWetPath::getFactorFor(sampleRate) : 1;
+  auto networkSampleRate = sampleRate / static_cast<float>(networkFactor);
+
   // Set the sample rate for each filter
-  for (auto& combFilter : combFilters) {
-    combFilter.setSampleRate(sampleRate);
-  }
-  
-  for (auto& allPassFilter : allPassFilters) {
-    allPassFilter.setSampleRate(sampleRate);
-  }
+  combBank.setSampleRate(networkSampleRate);
+  allPassFilters.setSampleRate(networkSampleRate);
+  standardAllPasses.setSampleRate(networkSampleRate);
+  highCombBank.setSampleRate(networkSampleRate);
+  highAllPasses.setSampleRate(networkSampleRate);
+  feedbackDelayNetwork.setSampleRate(networkSampleRate);
 }
 
 void Reverb::setMix(float value) {
   // Ensure mix is between 0.0 and 1.0
-  mix.setTargetValue(std::clamp(value, 0.0f, 1.0f));
+  auto newMix = std::clamp(value, 0.0f, 1.0f);
+
+  if (isSmoothed())
+    mix.setTargetValue(newMix);
+  else
+    mix.setCurrentAndTargetValue(newMix);
 }
 
 void Reverb::setDecay(float value) {
   // NOTE: We treat depth as the base value
-  // and set each comb filter's feedback from offsets
-  decay.setTargetValue(value);
-  
-  // make sure the base feedback is within range
-  float decayValue = decay.getNextValue();
-  for (auto& combFilter : combFilters) {
-    combFilter.setFeedback(decayValue);
+  // and set each comb filter's feedback from offsets.
+  // The comb bank ramps its feedback to the new decay sample by sample
+  decay = value;
+  combBank.setFeedback(decay, isSmoothed());
+  highCombBank.setFeedback(decay, isSmoothed());
+  feedbackDelayNetwork.setDecay(decay);
+  topologyEngine.setDecay(decay);
+}
+
+void Reverb::setRoomSize(float value) {
+  // The decay stays the same, as each comb's feedback follows its delay
+  roomSize = std::clamp(value, minRoomSize, CombBank::maxDelayScale);
+  combBank.setDelayScale(roomSize);
+  highCombBank.setDelayScale(roomSize);
+}
+
+void Reverb::setModulation(float value) {
+  modulation = std::clamp(value, 0.0f, 1.0f);
+
+  // The networks may run slower than the host, and the depth is in their
+  // samples
+  auto networkSampleRate = sampleRate / static_cast<float>(networkFactor);
+  lfoBank.setDepth(modulation * CombBank::maxModulationTime * networkSampleRate);
+}
+
+void Reverb::setDamping(float value) {
+  damping = std::clamp(value, 0.0f, 1.0f);
+  combBank.setDamping(damping);
+  highCombBank.setDamping(damping);
+}
+
+void Reverb::setProcessingMode(ProcessingMode newMode) {
+  processingMode = newMode;
+}
+
+void Reverb::setQuality(Quality newQuality) {
+  if (newQuality == quality)
+    return;
+
+  quality = newQuality;
+
+  // Before prepare() there is nothing to set up yet, and prepare() applies it
+  if (maxBlockSize > 0)
+    applyQuality();
+}
+
+void Reverb::applyQuality() {
+  auto standardTarget = quality == Quality::eco ? 0.0f : 1.0f;
+  auto highTarget = quality == Quality::high ? 1.0f : 0.0f;
+
+  // A layer that has been idle still holds whatever it had when it stopped
+  if (standardTarget > 0.0f && !standardLayerRunning) {
+    standardAllPasses.reset();
+    standardLayerRunning = true;
+  }
+
+  if (highTarget > 0.0f && !highLayerRunning) {
+    highCombBank.reset();
+    highAllPasses.reset();
+    highLayerRunning = true;
+  }
+
+  standardWeight.setTargetValue(standardTarget);
+  highWeight.setTargetValue(highTarget);
+}
+
+bool Reverb::areLayersSettled() const noexcept {
+  return !highLayerRunning &&
+         standardWeight.getValue() == standardWeight.getTargetValue();
+}
+
+void Reverb::setEngine(Engine newEngine) {
+  if (newEngine == engine)
+    return;
+
+  // Don't let the engine pick up a tail left over from the last time it ran
+  resetEngine(newEngine);
+  engine = newEngine;
+}
+
+void Reverb::resetEngine(Engine engineToReset) {
+  // Every network's output goes through send mode's side delay
+  if (networksAreMono && engineToReset != Engine::convolution)
+    sideDelay.clear();
+
+  if (engineToReset == Engine::feedbackDelayNetwork) {
+    feedbackDelayNetwork.reset();
+  } else if (engineToReset == Engine::convolution) {
+    convolution.reset();
+  } else if (engineToReset == Engine::topology) {
+    topologyEngine.reset();
+  } else {
+    combBank.reset();
+    allPassFilters.reset();
+    standardAllPasses.reset();
+    highCombBank.reset();
+    highAllPasses.reset();
+
+    // There's nothing left to fade, so the layers jump to where they're
+    // going
+    standardWeight.setCurrentAndTargetValue(standardWeight.getTargetValue());
+    highWeight.setCurrentAndTargetValue(highWeight.getTargetValue());
+    standardLayerRunning = standardWeight.getTargetValue() > 0.0f;
+    highLayerRunning = highWeight.getTargetValue() > 0.0f;
   }
 }
 
-void Reverb::prepare(float samplingRate) {
-  sampleRate = samplingRate;
+double Reverb::getTailLengthSeconds(Engine forEngine, float forDecay) const {
+  if (forEngine == Engine::convolution)
+    return convolution.getImpulseResponseLengthSeconds();
+
+  // The decay is the time the tail takes to fall by 60 dB, and it keeps
+  // falling at the same rate down to the silence threshold
+  auto decibelsToFall = -juce::Decibels::gainToDecibels(silenceThreshold);
+  return static_cast<double>(forDecay * decibelsToFall / 60.0f);
+}
+
+void Reverb::setStereoSpread(int samples) {
+  stereoSpread = samples;
+
+  // The spread is in samples at the host's rate, so the networks running
+  // slower get fewer of them
+  auto networkSpread = stereoSpread / networkFactor;
+  combBank.setStereoSpread(networkSpread);
+  allPassFilters.setStereoSpread(networkSpread);
+  standardAllPasses.setStereoSpread(networkSpread);
+  highCombBank.setStereoSpread(networkSpread);
+  highAllPasses.setStereoSpread(networkSpread);
+  topologyEngine.setStereoSpread(networkSpread);
+}
+
+void Reverb::loadImpulseResponse(juce::AudioBuffer<float> impulseResponse,
+                                 double impulseResponseSampleRate) {
+  convolution.loadImpulseResponse(std::move(impulseResponse),
+                                  impulseResponseSampleRate);
+}
+
+bool Reverb::loadTopology(const juce::ValueTree& topology) {
+  return topologyEngine.loadTopology(topology);
+}
+
+void Reverb::prepare(float samplingRate, int maximumBlockSize,
+                     int numChannels) {
+  setSampleRate(samplingRate);
+  maxBlockSize = maximumBlockSize;
   
   // Smoothed value setup
-  mix.reset(sampleRate, 0.05);
+  mix.prepare(sampleRate, 0.05, maxBlockSize);
   setMix(0.8f);
   
-  // Same for decay
-  decay.reset(sampleRate, 0.001);
   setDecay(2.5f);
+  setRoomSize(1.0f);
+  setModulation(0.0f);
+  setDamping(0.0f);
 
-  // Set the delay time and feedback for each comb filter
-  float combFilterDelayTimes[4] = { 30.1f, 34.2f, 39.1f, 45.1f };
-  
-  for (int i = 0; i < combFilters.size(); i++) {
-    combFilters[i].setDelayTime(combFilterDelayTimes[i]);
-    combFilters[i].setFeedback(decay.getNextValue());
-    combFilters[i].prepare(sampleRate, i % 2 == 0);
+  // Set the delay time and feedback for each comb filter and all-pass,
+  // including the layers of the tiers that aren't in use, so changing tiers
+  // never has to allocate. The all-pass chains only ever use whole delays
+  setUpCombs(combBank, combDelayTimes, numCombs);
+  setUpAllPasses(allPassFilters, allPassDelayTimes);
+  setUpAllPasses(standardAllPasses, standardAllPassDelayTimes);
+  setUpCombs(highCombBank, highCombDelayTimes, numHighCombs);
+  setUpAllPasses(highAllPasses, highAllPassDelayTimes);
+
+  setStereoSpread(stereoSpread);
+
+  // In send mode a stereo reverb's networks only need the one channel
+  networksAreMono = sendModeEnabled && numChannels > 1;
+  auto numNetworkChannels = networksAreMono ? 1 : numChannels;
+
+  // The side delay runs at the host's rate, after the networks
+  sideDelaySamples = juce::roundToInt(sideDelayTime * 0.001f * sampleRate);
+  auto sideDelaySize = networksAreMono
+      ? PowerOfTwoDelayLine::getRequiredSize(static_cast<float>(sideDelaySamples + maxBlockSize))
+      : 0;
+
+  // The network's delays are set from the sample rate
+  feedbackDelayNetwork.setNumLines(16);
+  feedbackDelayNetwork.setMatrix(FeedbackDelayNetwork::Matrix::hadamard);
+
+  // Allocate every delay line and intermediate buffer in one block up
+  // front, so process() never touches the heap or a fresh page
+  auto networkSampleRate = sampleRate / static_cast<float>(networkFactor);
+  auto memorySize =
+      ScratchArena::getMemorySize(numScratchBuffers, numChannels, maxBlockSize) +
+      MultirateWetPath::getMemorySize(sampleRate, networkFactor, numChannels, maxBlockSize) +
+      LfoBank::getMemorySize(maxBlockSize) +
+      combBank.getMemorySize(numCombs, numNetworkChannels) +
+      allPassFilters.getMemorySize(numNetworkChannels) +
+      standardAllPasses.getMemorySize(numNetworkChannels) +
+      highCombBank.getMemorySize(numHighCombs, numNetworkChannels) +
+      highAllPasses.getMemorySize(numNetworkChannels) +
+      feedbackDelayNetwork.getMemorySize() +
+      AlignedArena::getAllocationSize<float>(static_cast<size_t>(sideDelaySize));
+
+  memory.reset(memorySize);
+
+  // Lay the block out in the order process() walks through it
+  multirate.prepare(sampleRate, networkFactor, numChannels, maxBlockSize, memory);
+
+  lfoBank.prepare(networkSampleRate, maxBlockSize, memory);
+  combBank.prepare(networkSampleRate, numCombs, numNetworkChannels, memory);
+  combBank.setFeedback(decay, false);
+
+  allPassFilters.prepare(networkSampleRate, numNetworkChannels, memory);
+  standardAllPasses.prepare(networkSampleRate, numNetworkChannels, memory);
+
+  highCombBank.prepare(networkSampleRate, numHighCombs, numNetworkChannels, memory);
+  highCombBank.setFeedback(decay, false);
+
+  highAllPasses.prepare(networkSampleRate, numNetworkChannels, memory);
+
+  // The layers start out at the current tier's weights, with no fade
+  standardWeight.prepare(networkSampleRate, qualityFadeTime, maxBlockSize);
+  highWeight.prepare(networkSampleRate, qualityFadeTime, maxBlockSize);
+  standardLayerRunning = highLayerRunning = false;
+  applyQuality();
+  standardWeight.setCurrentAndTargetValue(standardWeight.getTargetValue());
+  highWeight.setCurrentAndTargetValue(highWeight.getTargetValue());
+
+  feedbackDelayNetwork.prepare(networkSampleRate, numNetworkChannels, memory);
+  feedbackDelayNetwork.setDecay(decay);
+
+  if (networksAreMono)
+    sideDelay.setMemory(memory.allocate<float>(static_cast<size_t>(sideDelaySize)), sideDelaySize);
+
+  scratch.prepare(numScratchBuffers, numChannels, maxBlockSize, memory);
+  jassert(memory.getNumBytesUsed() == memory.getSize());
+
+  // Rebuilds the engine for any impulse response loaded so far. The impulse
+  // response has everything above 20 kHz in it too, so it runs at the
+  // host's rate
+  convolution.prepare(sampleRate, numChannels);
+
+  // The topology engine keeps its own block too, sized for the topology
+  topologyEngine.prepare(networkSampleRate,
+                         MultirateWetPath::getMaxNetworkBlockSize(networkFactor, maxBlockSize),
+                         numNetworkChannels);
+
+  sleeping = false;
+  quietSamples = 0;
+}
+
+void Reverb::process(juce::AudioBuffer<float>& buffer) {
+  // The scratch arena is only big enough for the prepared block size
+  jassert(buffer.getNumSamples() <= maxBlockSize);
+  jassert(buffer.getNumChannels() <= scratch.getMaxNumChannels());
+
+  auto numSamples = buffer.getNumSamples();
+  auto inputIsSilent = buffer.getMagnitude(0, numSamples) < silenceThreshold;
+
+  // Asleep, the delay lines are empty, so silence in is silence out
+  if (sleeping) {
+    if (inputIsSilent) {
+      buffer.clear();
+      mix.skip(numSamples);
+      return;
+    }
+
+    sleeping = false;
   }
-  
-  allPassFilters[0].setDelayTime(1.2f);
-  allPassFilters[0].setFeedback(0.5f);
-  
-  allPassFilters[1].setDelayTime(3.6f);
-  allPassFilters[1].setFeedback(0.5f);
-  
-  for (auto& allPassFilter : allPassFilters) {
-    allPassFilter.prepare(sampleRate);
+
+  // Every channel mixes with the same ramp
+  mix.render(numSamples);
+
+  // Fusing the all-passes and the mix into the combs' loop only works when
+  // the combs run at the host's rate on every channel and there's only one
+  // bank of them
+  if (engine == Engine::schroeder && processingMode == ProcessingMode::fused &&
+      networkFactor == 1 && !networksAreMono && areLayersSettled()) {
+    processFused(buffer);
+  } else {
+    processMultiPass(buffer);
   }
+
+  updateSleep(inputIsSilent, inputIsSilent ? buffer.getMagnitude(0, numSamples) : 0.0f,
+              numSamples);
 }
 
-void Reverb::process(juce::AudioBuffer<float>& buffer) {
+void Reverb::updateSleep(bool inputIsSilent, float outputPeak, int numSamples) {
+  if (!inputIsSilent || outputPeak >= silenceThreshold) {
+    quietSamples = 0;
+    return;
+  }
+
+  // A convolution tail is over once the input has been silent for the
+  // whole impulse response. The networks are checked every so often
+  quietSamples += numSamples;
+  auto quietSamplesNeeded = static_cast<int>(tailCheckTime * sampleRate);
+
+  if (engine == Engine::convolution)
+    quietSamplesNeeded = std::max(quietSamplesNeeded, convolution.getTailLength());
+
+  if (quietSamples < quietSamplesNeeded)
+    return;
+
+  quietSamples = 0;
+
+  // The output can dip below the threshold while a tail is still going
+  // round the delay lines, so only sleep once they are all silent too.
+  // Clearing them gets rid of any denormals left behind
+  if (getEnginePeakLevel() < silenceThreshold) {
+    resetEngine(engine);
+    multirate.reset();
+    sleeping = true;
+  }
+}
+
+float Reverb::getEnginePeakLevel() const noexcept {
+  // Nothing is left in the convolution once the input has been silent for
+  // the length of the impulse response
+  if (engine == Engine::convolution)
+    return 0.0f;
+
+  // Send mode's side delay holds the last of the tail too
+  auto peak = networksAreMono ? sideDelay.getPeakLevel() : 0.0f;
+
+  if (engine == Engine::feedbackDelayNetwork)
+    return std::max(peak, feedbackDelayNetwork.getPeakLevel());
+
+  if (engine == Engine::topology)
+    return std::max(peak, topologyEngine.getPeakLevel());
+
+  peak = std::max({ peak, combBank.getPeakLevel(), allPassFilters.getPeakLevel() });
+
+  if (standardLayerRunning)
+    peak = std::max(peak, standardAllPasses.getPeakLevel());
+
+  if (highLayerRunning)
+    peak = std::max({ peak, highCombBank.getPeakLevel(), highAllPasses.getPeakLevel() });
+
+  return peak;
+}
+
+void Reverb::processMultiPass(juce::AudioBuffer<float>& buffer) {
   int numSamples = buffer.getNumSamples();
   int numChannels = buffer.getNumChannels();
 
-  // Process the input sample through each comb filter
-  // NOTE:: Since the comb filters are in parallel, we have to
-  // process each comb filter separately on the input sample
-  // and then mix the output samples together
-  juce::AudioBuffer<float> wetBuffer(buffer.getNumChannels(),
-                                     buffer.getNumSamples());
-  wetBuffer.clear();
+  auto wetBuffer = scratch.getBuffer(wetScratch, numChannels, numSamples);
+
+  if (engine == Engine::convolution) {
+    // The dry signal is delayed whichever engine is running, so the latency
+    // the host compensates for never changes, and the convolution is given
+    // the delayed signal to stay in line with it. Its stereo image comes from
+    // the impulse response, so it runs on every channel even in send mode
+    if (networkFactor != 1)
+      multirate.delayDry(buffer);
+
+    renderWet(buffer, wetBuffer);
+    mixWet(buffer, wetBuffer);
+    return;
+  }
+
+  // In send mode the networks run on the wet buffer's first channel, which
+  // starts out as the input summed to mono
+  auto networkWet = networksAreMono ? scratch.getBuffer(wetScratch, 1, numSamples) : wetBuffer;
+
+  if (networksAreMono)
+    sumToMono(buffer, networkWet);
+
+  const auto& networkInput = networksAreMono ? networkWet : buffer;
+
+  if (networkFactor == 1) {
+    renderWet(networkInput, networkWet);
+  } else {
+    // The network runs on the decimated input, in place, and its output is
+    // interpolated back up to the host's rate
+    auto networkBuffer = scratch.getBuffer(networkScratch, networkWet.getNumChannels(),
+                                           multirate.getNumNetworkSamples(numSamples));
+    multirate.decimate(networkInput, networkBuffer);
+    multirate.delayDry(buffer);
+
+    renderWet(networkBuffer, networkBuffer);
+    multirate.interpolate(networkBuffer, networkWet);
+  }
+
+  if (!networksAreMono) {
+    mixWet(buffer, wetBuffer);
+    return;
+  }
+
+  // Fully wet, the dry signal isn't needed any more, so the decorrelated
+  // channels are written straight over it
+  if (!mix.isRamping() && mix.getValue() == 1.0f) {
+    decorrelate(networkWet, buffer);
+    return;
+  }
+
+  decorrelate(networkWet, wetBuffer);
+  mixWet(buffer, wetBuffer);
+}
+
+void Reverb::renderWet(const juce::AudioBuffer<float>& input,
+                       juce::AudioBuffer<float>& wetBuffer) {
+  if (engine == Engine::feedbackDelayNetwork) {
+    // The network is dense enough on its own, so it skips the all-passes
+    feedbackDelayNetwork.process(input, wetBuffer);
+  } else if (engine == Engine::convolution) {
+    // The impulse response sets the decay, so the decay parameter is ignored
+    convolution.process(input, wetBuffer);
+  } else if (engine == Engine::topology) {
+    topologyEngine.process(input, wetBuffer);
+  } else {
+    renderSchroeder(input, wetBuffer);
+  }
+}
+
+void Reverb::renderSchroeder(const juce::AudioBuffer<float>& input,
+                             juce::AudioBuffer<float>& wetBuffer) {
+  int numSamples = input.getNumSamples();
+  int numChannels = input.getNumChannels();
+
+  standardWeight.render(numSamples);
+  highWeight.render(numSamples);
+  updateModulation(numSamples);
+
+  // High's extra combs go first, as the main bank may write over the input
+  juce::AudioBuffer<float> highCombBuffer;
 
-  for (auto& combFilter : combFilters) {
-    // Create a temporary buffer to hold the output of the comb filter
-    // ensuring each comb filter is processed in parallel
-    juce::AudioBuffer<float> tempBuffer;
-    tempBuffer.makeCopyOf(buffer);
+  if (highLayerRunning) {
+    highCombBuffer = scratch.getBuffer(layerScratch, numChannels, numSamples);
 
-    // Process the comb filter
-    combFilter.process(tempBuffer);
+    if (highWeight.isRamping()) {
+      // Combs started from silence on a running signal would have their
+      // first echo start with a step, so the input is faded as well
+      auto* weights = highWeight.getValues();
+
+      for (int channel = 0; channel < numChannels; ++channel) {
+        auto* inputData = input.getReadPointer(channel);
+        auto* highData = highCombBuffer.getWritePointer(channel);
+
+        for (int i = 0; i < numSamples; ++i) {
+          highData[i] = weights[i] * inputData[i];
+        }
+      }
+
+      highCombBank.process(highCombBuffer, highCombBuffer);
+    } else {
+      highCombBank.process(input, highCombBuffer);
+    }
+  }
+
+  // Process the input through the comb filters
+  // NOTE:: The comb filters are in parallel, so the bank runs
+  // them all on the same input and averages their outputs
+  combBank.process(input, wetBuffer);
+
+  // Fully faded in, the two banks are averaged as if they were one of
+  // eight combs
+  if (highLayerRunning) {
+    auto* weights = highWeight.getValues();
 
-    // Mix the output of the comb filter with the wet buffer
     for (int channel = 0; channel < numChannels; ++channel) {
-      wetBuffer.addFrom(channel, 0, tempBuffer, channel, 0,
-                        buffer.getNumSamples());
+      auto* wetData = wetBuffer.getWritePointer(channel);
+      auto* highData = highCombBuffer.getReadPointer(channel);
+
+      for (int i = 0; i < numSamples; ++i) {
+        wetData[i] += 0.5f * weights[i] * (highData[i] - wetData[i]);
+      }
     }
   }
-  
-  // Average out the gain levels
-  wetBuffer.applyGain(1.0f / static_cast<float>(combFilters.size()));
-  
-  // Apply allpass filter
-  allPassFilters[0].process(wetBuffer);
-  
-  // Apply allpass filter
-  allPassFilters[1].process(wetBuffer);
-  
+
+  // Apply the allpass filters
+  allPassFilters.process(wetBuffer);
+
+  if (standardLayerRunning)
+    applyAllPassLayer(standardAllPasses, standardWeight, wetBuffer);
+
+  if (highLayerRunning)
+    applyAllPassLayer(highAllPasses, highWeight, wetBuffer);
+
+  // Layers that have faded out stop running until they're needed again
+  if (standardWeight.getValue() == 0.0f && standardWeight.getTargetValue() == 0.0f)
+    standardLayerRunning = false;
+
+  if (highWeight.getValue() == 0.0f && highWeight.getTargetValue() == 0.0f)
+    highLayerRunning = false;
+}
+
+void Reverb::updateModulation(int numSamples) {
+  const float* lines = nullptr;
+
+  if (lfoBank.isActive()) {
+    // High's combs take up the most lanes when they're running
+    auto numLanesInUse = highLayerRunning ? highCombBank.getNumLanes() : combBank.getNumLanes();
+    lfoBank.process(numSamples, numLanesInUse);
+    lines = lfoBank.getLines();
+  }
+
+  auto firstLineLength = lfoBank.getFirstLineLength();
+  combBank.setModulation(lines, firstLineLength, LfoBank::controlInterval);
+  highCombBank.setModulation(lines, firstLineLength, LfoBank::controlInterval);
+}
+
+void Reverb::applyAllPassLayer(AllPassChain& layer,
+                               const ParameterRamp<float>& weight,
+                               juce::AudioBuffer<float>& wetBuffer) {
+  // Fully faded in, the layer is just the next stage of the chain
+  if (!weight.isRamping() && weight.getValue() == 1.0f) {
+    layer.process(wetBuffer);
+    return;
+  }
+
+  int numSamples = wetBuffer.getNumSamples();
+  int numChannels = wetBuffer.getNumChannels();
+
+  auto layerBuffer = scratch.getBuffer(layerScratch, numChannels, numSamples);
+  auto* weights = weight.getValues();
+
+  // The layer's input is faded as well as its output, so its first echoes
+  // don't start with a step when it fades in, and what is still ringing in
+  // it doesn't stop with one when it fades out
+  for (int channel = 0; channel < numChannels; ++channel) {
+    auto* wetData = wetBuffer.getReadPointer(channel);
+    auto* layerData = layerBuffer.getWritePointer(channel);
+
+    for (int i = 0; i < numSamples; ++i) {
+      layerData[i] = weights[i] * wetData[i];
+    }
+  }
+
+  layer.process(layerBuffer);
+
+  for (int channel = 0; channel < numChannels; ++channel) {
+    auto* wetData = wetBuffer.getWritePointer(channel);
+    auto* layerData = layerBuffer.getReadPointer(channel);
+
+    for (int i = 0; i < numSamples; ++i) {
+      wetData[i] = (1.0f - weights[i]) * wetData[i] + weights[i] * layerData[i];
+    }
+  }
+}
+
+void Reverb::sumToMono(const juce::AudioBuffer<float>& buffer,
+                       juce::AudioBuffer<float>& monoBuffer) {
+  int numSamples = buffer.getNumSamples();
+  int numChannels = buffer.getNumChannels();
+  auto gain = 1.0f / static_cast<float>(numChannels);
+  auto* monoData = monoBuffer.getWritePointer(0);
+
+  juce::FloatVectorOperations::copyWithMultiply(monoData, buffer.getReadPointer(0), gain,
+                                                numSamples);
+
+  for (int channel = 1; channel < numChannels; ++channel) {
+    juce::FloatVectorOperations::addWithMultiply(monoData, buffer.getReadPointer(channel),
+                                                 gain, numSamples);
+  }
+}
+
+void Reverb::decorrelate(const juce::AudioBuffer<float>& monoBuffer,
+                         juce::AudioBuffer<float>& output) {
+  jassert(output.getNumChannels() == 2);
+
+  int numSamples = output.getNumSamples();
+  auto* monoData = monoBuffer.getReadPointer(0);
+  auto* left = output.getWritePointer(0);
+  auto* right = output.getWritePointer(1);
+
+  // The right channel holds the side signal until it is needed, which is
+  // why the mono signal may share the left one
+  sideDelay.writeBlock(monoData, numSamples);
+  sideDelay.readBlock(right, numSamples, sideDelaySamples);
+
+  // The mono wet signal is the mid and the delayed one the side, which
+  // makes two channels that don't correlate but still add back up to the
+  // mono signal, so the send folds down to mono without colouring
+  constexpr auto gain = juce::MathConstants<float>::sqrt2 * 0.5f;
+
+  for (int i = 0; i < numSamples; ++i) {
+    auto mid = monoData[i];
+    auto side = right[i];
+    left[i] = gain * (mid + side);
+    right[i] = gain * (mid - side);
+  }
+}
+
+void Reverb::mixWet(juce::AudioBuffer<float>& buffer,
+                    const juce::AudioBuffer<float>& wetBuffer) {
+  int numSamples = buffer.getNumSamples();
+  int numChannels = buffer.getNumChannels();
+
   // Mix the wet buffer with the original input buffer
+  if (!mix.isRamping()) {
+    auto mixVal = mix.getValue();
+
+    // Fully wet, the dry signal is simply written over
+    if (mixVal == 1.0f) {
+      for (int channel = 0; channel < numChannels; ++channel)
+        buffer.copyFrom(channel, 0, wetBuffer, channel, 0, numSamples);
+
+      return;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto* channelData = buffer.getWritePointer(channel);
+      auto* wetChannelData = wetBuffer.getReadPointer(channel);
+
+      for (int i = 0; i < numSamples; ++i) {
+        channelData[i] = (1.0f - mixVal) * channelData[i] + mixVal * wetChannelData[i];
+      }
+    }
+
+    return;
+  }
+
+  auto* mixValues = mix.getValues();
+
   for (int channel = 0; channel < numChannels; ++channel) {
     auto* channelData = buffer.getWritePointer(channel);
     auto* wetChannelData = wetBuffer.getReadPointer(channel);
@@ -116,9 +701,35 @@ void Reverb::process(juce::AudioBuffer<float>& buffer) {
       auto wetSample = wetChannelData[i];
 
       // Mix the wet sample with the input sample
-      float mixVal = mix.getNextValue();
+      float mixVal = mixValues[i];
       channelData[i] = (1.0f - mixVal) * drySample + mixVal * wetSample;
     }
   }
-  
+}
+
+void Reverb::processFused(juce::AudioBuffer<float>& buffer) {
+  // Everything after the combs runs inside the comb bank's loop, so each
+  // sample makes a single trip through the network without ever being
+  // written to an intermediate buffer
+  // The mix array holds the value for every sample, ramping or not
+  auto* mixValues = mix.getValues();
+
+  // Only taken with the layers settled, so Standard's is either all the way
+  // in or out, and High's is out
+  auto standardIsOn = standardWeight.getTargetValue() > 0.0f;
+
+  auto allPassAndMix = [this, mixValues, standardIsOn](int channel, int i,
+                                                       float drySample,
+                                                       float wetSample) {
+    wetSample = allPassFilters.processSample(channel, wetSample);
+
+    if (standardIsOn)
+      wetSample = standardAllPasses.processSample(channel, wetSample);
+
+    auto mixVal = mixValues[i];
+    return (1.0f - mixVal) * drySample + mixVal * wetSample;
+  };
+
+  updateModulation(buffer.getNumSamples());
+  combBank.process(buffer, buffer, allPassAndMix);
 }
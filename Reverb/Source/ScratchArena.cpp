@@ -0,0 +1,40 @@
+#include "ScratchArena.h"
+
+size_t ScratchArena::getMemorySize(int numBuffers, int numChannels,
+                                   int numSamples) {
+  auto numChannelBuffers = static_cast<size_t>(numBuffers * numChannels);
+
+  return AlignedArena::getAllocationSize<float*>(numChannelBuffers) +
+         numChannelBuffers *
+             AlignedArena::getAllocationSize<float>(static_cast<size_t>(numSamples));
+}
+
+void ScratchArena::prepare(int numBuffers, int numChannels, int numSamples,
+                           AlignedArena& arena) {
+  jassert(numBuffers > 0 && numChannels > 0 && numSamples > 0);
+
+  maxNumBuffers = numBuffers;
+  maxNumChannels = numChannels;
+  maxNumSamples = numSamples;
+
+  auto numChannelBuffers = static_cast<size_t>(numBuffers * numChannels);
+  channelPointers = arena.allocate<float*>(numChannelBuffers);
+
+  for (size_t i = 0; i < numChannelBuffers; ++i) {
+    channelPointers[i] = arena.allocate<float>(static_cast<size_t>(numSamples));
+  }
+}
+
+juce::AudioBuffer<float> ScratchArena::getBuffer(int index, int numChannels,
+                                                 int numSamples) {
+  // Asking for more than was prepared would mean reading past the arena
+  jassert(index >= 0 && index < maxNumBuffers);
+  jassert(numChannels <= maxNumChannels);
+  jassert(numSamples <= maxNumSamples);
+
+  // AudioBuffer keeps the channel pointers of small views in its own
+  // preallocated space, so creating one here doesn't touch the heap
+  return juce::AudioBuffer<float>(
+      channelPointers + index * maxNumChannels, numChannels,
+      numSamples);
+}
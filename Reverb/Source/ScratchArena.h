@@ -0,0 +1,37 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AlignedArena.h"
+
+/**
+ * Preallocated scratch memory for the intermediate buffers of an effect.
+ *
+ * The arena is sized once in prepare() and then hands out AudioBuffer views
+ * into its memory, so the audio thread never has to allocate. The memory
+ * itself is taken from an AlignedArena, and every channel starts on a new
+ * cache line.
+ */
+class ScratchArena {
+public:
+  // Bytes prepare() takes from the arena
+  static size_t getMemorySize(int numBuffers, int numChannels, int numSamples);
+
+  // The buffers are taken from the arena, which must outlive the scratch
+  void prepare(int numBuffers, int numChannels, int numSamples,
+               AlignedArena& arena);
+
+  // Returns a view onto one of the scratch buffers. The view does not own
+  // its memory and is only valid until the next call to prepare()
+  juce::AudioBuffer<float> getBuffer(int index, int numChannels,
+                                     int numSamples);
+
+  int getMaxNumChannels() const noexcept { return maxNumChannels; }
+  int getMaxNumSamples() const noexcept { return maxNumSamples; }
+
+private:
+  int maxNumBuffers = 0;
+  int maxNumChannels = 0;
+  int maxNumSamples = 0;
+
+  float** channelPointers = nullptr;  // channel starts for every buffer
+};
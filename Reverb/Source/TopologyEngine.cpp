@@ -0,0 +1,597 @@
+#include "TopologyEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace {
+const juce::Identifier topologyType { "Topology" };
+const juce::Identifier seriesType { "Series" };
+const juce::Identifier parallelType { "Parallel" };
+const juce::Identifier combType { "Comb" };
+const juce::Identifier allPassType { "AllPass" };
+const juce::Identifier delayType { "Delay" };
+
+const juce::Identifier delayProperty { "delay" };
+const juce::Identifier gainProperty { "gain" };
+const juce::Identifier feedbackProperty { "feedback" };
+const juce::Identifier invertedProperty { "inverted" };
+
+// Hands out the scratch slots a topology is compiled onto. Slots are taken
+// and released in nested order, so the most ever in use at once is all the
+// plan needs
+struct SlotAllocator {
+  int next = 1;  // slot 0 is the output
+  int used = 1;
+
+  int take() noexcept {
+    used = std::max(used, next + 1);
+    return next++;
+  }
+
+  void release() noexcept { --next; }
+};
+}
+
+TopologyEngine::TopologyEngine() {}
+
+TopologyEngine::~TopologyEngine() {
+  delete pending.exchange(nullptr);
+  delete retired.exchange(nullptr);
+}
+
+juce::ValueTree TopologyEngine::createClassicTopology() {
+  juce::ValueTree combs { parallelType };
+  const float combDelayTimes[] = { 30.1f, 34.2f, 39.1f, 45.1f };
+
+  for (int i = 0; i < 4; ++i) {
+    juce::ValueTree comb { combType };
+    comb.setProperty(delayProperty, combDelayTimes[i], nullptr);
+    comb.setProperty(invertedProperty, i % 2 == 0, nullptr);
+    combs.appendChild(comb, nullptr);
+  }
+
+  juce::ValueTree topology { topologyType };
+  topology.appendChild(combs, nullptr);
+
+  for (auto delayTime : { 1.2f, 3.6f }) {
+    juce::ValueTree allPass { allPassType };
+    allPass.setProperty(delayProperty, delayTime, nullptr);
+    allPass.setProperty(gainProperty, 0.5f, nullptr);
+    topology.appendChild(allPass, nullptr);
+  }
+
+  return topology;
+}
+
+bool TopologyEngine::compile(const juce::ValueTree& tree, Program& program) {
+  SlotAllocator slots;
+
+  // Adds the node a leaf describes, or returns -1 if it isn't valid
+  auto addNode = [&program](const juce::ValueTree& leaf) {
+    NodeDescription node;
+
+    if (leaf.hasType(combType)) {
+      node.type = NodeType::comb;
+    } else if (leaf.hasType(allPassType)) {
+      node.type = NodeType::allPass;
+    } else if (leaf.hasType(delayType)) {
+      node.type = NodeType::delay;
+    } else {
+      return -1;
+    }
+
+    node.delayTime = static_cast<float>(leaf.getProperty(delayProperty, 0.0f));
+
+    if (node.delayTime <= 0.0f || node.delayTime > maxDelayTime)
+      return -1;
+
+    if (node.type == NodeType::comb) {
+      node.followsDecay = !leaf.hasProperty(feedbackProperty);
+
+      if (node.followsDecay) {
+        node.gain = static_cast<bool>(leaf.getProperty(invertedProperty, false)) ? -1.0f : 1.0f;
+      } else {
+        node.gain = static_cast<float>(leaf.getProperty(feedbackProperty));
+      }
+    } else {
+      auto defaultGain = node.type == NodeType::allPass ? 0.5f : 1.0f;
+      node.gain = static_cast<float>(leaf.getProperty(gainProperty, defaultGain));
+    }
+
+    // Anything that feeds back has to stay stable
+    if (node.type != NodeType::delay && !(std::abs(node.gain) < 1.0f) && !node.followsDecay)
+      return -1;
+
+    if (static_cast<int>(program.nodes.size()) == maxNumNodes)
+      return -1;
+
+    program.nodes.push_back(node);
+    return static_cast<int>(program.nodes.size()) - 1;
+  };
+
+  auto getNodeOperation = [&program](int node) {
+    auto type = program.nodes[static_cast<size_t>(node)].type;
+
+    if (type == NodeType::comb)
+      return Operation::comb;
+
+    return type == NodeType::allPass ? Operation::allPass : Operation::delay;
+  };
+
+  // Compiles a node or group to run in place on a slot
+  std::function<bool(const juce::ValueTree&, int)> compileChild;
+
+  auto compileSeries = [&compileChild](const juce::ValueTree& group, int slot) {
+    for (const auto& child : group) {
+      if (!compileChild(child, slot))
+        return false;
+    }
+
+    return true;
+  };
+
+  compileChild = [&](const juce::ValueTree& child, int slot) {
+    if (child.hasType(seriesType))
+      return compileSeries(child, slot);
+
+    if (!child.hasType(parallelType)) {
+      auto node = addNode(child);
+
+      if (node < 0)
+        return false;
+
+      program.steps.push_back({ getNodeOperation(node), slot, slot, node, 1.0f });
+      return true;
+    }
+
+    auto numChildren = child.getNumChildren();
+
+    if (numChildren == 0)
+      return false;
+
+    auto sum = slots.take();
+    program.steps.push_back({ Operation::clear, sum, sum, -1, 1.0f });
+
+    for (const auto& branch : child) {
+      // A single comb can add its output straight into the sum
+      if (branch.hasType(combType)) {
+        auto node = addNode(branch);
+
+        if (node < 0)
+          return false;
+
+        program.steps.push_back({ Operation::combAccumulate, slot, sum, node, 1.0f });
+        continue;
+      }
+
+      auto branchSlot = slots.take();
+      program.steps.push_back({ Operation::copy, slot, branchSlot, -1, 1.0f });
+
+      if (!compileChild(branch, branchSlot))
+        return false;
+
+      program.steps.push_back({ Operation::accumulate, branchSlot, sum, -1, 1.0f });
+      slots.release();
+    }
+
+    auto gain = static_cast<float>(child.getProperty(
+        gainProperty, 1.0f / static_cast<float>(numChildren)));
+    program.steps.push_back({ Operation::scale, sum, slot, -1, gain });
+    slots.release();
+    return true;
+  };
+
+  if (!tree.hasType(topologyType) || !compileSeries(tree, 0))
+    return false;
+
+  program.numSlots = slots.used;
+  return true;
+}
+
+bool TopologyEngine::loadTopology(const juce::ValueTree& newTopology) {
+  Program program;
+
+  if (!compile(newTopology, program))
+    return false;
+
+  topology = newTopology.createCopy();
+
+  // Before prepare() the topology is only kept for later
+  if (auto plan = createPlan())
+    publish(std::move(plan));
+
+  return true;
+}
+
+void TopologyEngine::prepare(float samplingRate, int maximumBlockSize,
+                             int numberOfChannels) {
+  jassert(numberOfChannels > 0 && numberOfChannels <= maxNumChannels);
+
+  sampleRate = samplingRate;
+  maxBlockSize = maximumBlockSize;
+  numChannels = numberOfChannels;
+
+  // Nothing is processing, so the new plan can go straight in
+  delete pending.exchange(nullptr);
+  releaseRetiredPlan();
+  current = createPlan();
+}
+
+void TopologyEngine::publish(std::unique_ptr<Plan> plan) {
+  releaseRetiredPlan();
+
+  // A plan still pending was never seen by the audio thread
+  delete pending.exchange(plan.release(), std::memory_order_acq_rel);
+}
+
+void TopologyEngine::releaseRetiredPlan() {
+  delete retired.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+std::unique_ptr<TopologyEngine::Plan> TopologyEngine::createPlan() const {
+  Program program;
+
+  if (sampleRate <= 0.0f || numChannels == 0 || !topology.isValid() ||
+      !compile(topology, program))
+    return nullptr;
+
+  auto plan = std::make_unique<Plan>();
+  plan->steps = std::move(program.steps);
+  plan->numSlots = program.numSlots;
+  plan->numChannels = numChannels;
+  plan->maxBlockSize = maxBlockSize;
+
+  // Every ring holds its delay with the most spread twice over, so a whole
+  // delay's worth of samples can be read in one run while the same number
+  // are written without the two ever overlapping
+  auto getRingSize = [this](const NodeDescription& node) {
+    auto delay = std::max(1, static_cast<int>(std::round(node.delayTime / 1000.0f * sampleRate)));
+    return PowerOfTwoDelayLine::getRequiredSize(static_cast<float>(2 * (delay + maxStereoSpread)));
+  };
+
+  auto slotSize = static_cast<size_t>((plan->numSlots - 1) * numChannels * maxBlockSize);
+  auto memorySize = AlignedArena::getAllocationSize<float>(slotSize);
+
+  for (const auto& node : program.nodes) {
+    memorySize += static_cast<size_t>(numChannels) *
+                  AlignedArena::getAllocationSize<float>(static_cast<size_t>(getRingSize(node)));
+  }
+
+  plan->memory.reset(memorySize);
+  plan->slotMemory = plan->memory.allocate<float>(slotSize);
+  plan->nodes.resize(program.nodes.size());
+
+  for (size_t i = 0; i < program.nodes.size(); ++i) {
+    auto& node = plan->nodes[i];
+    node.description = program.nodes[i];
+
+    auto ringSize = getRingSize(node.description);
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      node.lines[static_cast<size_t>(channel)].setMemory(
+          plan->memory.allocate<float>(static_cast<size_t>(ringSize)), ringSize);
+    }
+  }
+
+  jassert(plan->memory.getNumBytesUsed() == plan->memory.getSize());
+  return plan;
+}
+
+void TopologyEngine::reset() noexcept {
+  if (current == nullptr)
+    return;
+
+  for (auto& node : current->nodes) {
+    for (int channel = 0; channel < current->numChannels; ++channel) {
+      node.lines[static_cast<size_t>(channel)].clear();
+    }
+  }
+
+  finishFeedbackRamp(*current);
+}
+
+void TopologyEngine::setStereoSpread(int samples) noexcept {
+  jassert(samples >= 0 && samples <= maxStereoSpread);
+  stereoSpread = samples;
+}
+
+float TopologyEngine::getPeakLevel() const noexcept {
+  if (current == nullptr)
+    return 0.0f;
+
+  float peak = 0.0f;
+
+  for (const auto& node : current->nodes) {
+    for (int channel = 0; channel < current->numChannels; ++channel) {
+      peak = std::max(peak, node.lines[static_cast<size_t>(channel)].getPeakLevel());
+    }
+  }
+
+  return peak;
+}
+
+void TopologyEngine::updatePlan(Plan& plan) noexcept {
+  auto spreadChanged = plan.spreadCache.update({ static_cast<float>(stereoSpread) });
+
+  if (spreadChanged) {
+    for (auto& node : plan.nodes) {
+      auto delay = std::max(1, static_cast<int>(std::round(
+          node.description.delayTime / 1000.0f * sampleRate)));
+
+      // The right channel is spread out from the left
+      for (int channel = 0; channel < plan.numChannels; ++channel) {
+        node.delays[static_cast<size_t>(channel)] = delay + channel * stereoSpread;
+      }
+    }
+
+    plan.decayCache.invalidate();
+  }
+
+  if (!plan.decayCache.update({ decayTime }))
+    return;
+
+  // The same mapping and limit as CombBank
+  constexpr float maxLogFeedback = -0.07400058f;  // log2(0.95)
+  auto exponentPerSample = getDecayExponent(decayTime, sampleRate);
+
+  auto rampLength = static_cast<int>(feedbackRampTime * sampleRate);
+  auto shouldRamp = plan.hasProcessed && !spreadChanged && rampLength > 0;
+  auto inverseRampLength = 1.0f / static_cast<float>(std::max(rampLength, 1));
+
+  for (auto& node : plan.nodes) {
+    // A fixed feedback stays where it is through the ramp
+    if (!node.description.followsDecay) {
+      node.feedbackRatio.fill(1.0f);
+      continue;
+    }
+
+    for (size_t channel = 0; channel < maxNumChannels; ++channel) {
+      auto logGain = std::min(static_cast<float>(node.delays[channel]) * exponentPerSample,
+                              maxLogFeedback);
+      node.targetLogFeedback[channel] = logGain;
+      node.targetFeedback[channel] = node.description.gain * fastExp2(logGain);
+
+      node.logFeedbackStep[channel] =
+          (logGain - node.logFeedback[channel]) * inverseRampLength;
+      node.feedbackRatio[channel] = fastExp2(node.logFeedbackStep[channel]);
+    }
+  }
+
+  if (!shouldRamp) {
+    finishFeedbackRamp(plan);
+    return;
+  }
+
+  plan.rampSamplesRemaining = rampLength;
+}
+
+void TopologyEngine::advanceFeedbackRamp(Plan& plan, int numSamples) noexcept {
+  auto numSteps = std::min(numSamples, plan.rampSamplesRemaining);
+  plan.rampSamplesRemaining -= numSteps;
+
+  if (plan.rampSamplesRemaining == 0) {
+    finishFeedbackRamp(plan);
+    return;
+  }
+
+  for (auto& node : plan.nodes) {
+    for (size_t channel = 0; channel < maxNumChannels; ++channel) {
+      node.logFeedback[channel] += static_cast<float>(numSteps) * node.logFeedbackStep[channel];
+    }
+  }
+}
+
+void TopologyEngine::finishFeedbackRamp(Plan& plan) noexcept {
+  for (auto& node : plan.nodes) {
+    if (node.description.followsDecay) {
+      node.feedback = node.targetFeedback;
+      node.logFeedback = node.targetLogFeedback;
+    } else {
+      node.feedback.fill(node.description.gain);
+    }
+  }
+
+  plan.rampSamplesRemaining = 0;
+}
+
+void TopologyEngine::process(const juce::AudioBuffer<float>& input,
+                             juce::AudioBuffer<float>& output) {
+  jassert(output.getNumChannels() == input.getNumChannels());
+  jassert(output.getNumSamples() >= input.getNumSamples());
+
+  auto numSamples = input.getNumSamples();
+
+  // Pick up a newly loaded topology, as long as the loading thread has
+  // freed the last one this replaced
+  if (retired.load(std::memory_order_acquire) == nullptr) {
+    if (auto* next = pending.exchange(nullptr, std::memory_order_acq_rel)) {
+      retired.store(current.release(), std::memory_order_release);
+      current.reset(next);
+    }
+  }
+
+  if (current == nullptr) {
+    for (int channel = 0; channel < output.getNumChannels(); ++channel) {
+      output.clear(channel, 0, numSamples);
+    }
+
+    return;
+  }
+
+  auto& plan = *current;
+  jassert(input.getNumChannels() == plan.numChannels);
+  jassert(numSamples <= plan.maxBlockSize);
+
+  updatePlan(plan);
+  plan.hasProcessed = true;
+
+  // The steps run in place on the output
+  for (int channel = 0; channel < plan.numChannels; ++channel) {
+    if (output.getReadPointer(channel) != input.getReadPointer(channel))
+      output.copyFrom(channel, 0, input, channel, 0, numSamples);
+  }
+
+  auto* outputData = output.getArrayOfWritePointers();
+
+  // As in CombBank, only the samples a ramp covers run the ramping steps
+  auto rampEnd = std::min(numSamples, plan.rampSamplesRemaining);
+
+  if (rampEnd > 0) {
+    runSteps<true>(plan, outputData, 0, rampEnd);
+    advanceFeedbackRamp(plan, rampEnd);
+  }
+
+  if (rampEnd < numSamples) {
+    runSteps<false>(plan, outputData, rampEnd, numSamples - rampEnd);
+  }
+}
+
+namespace {
+// Calls run(delayed, written, offset, length) over the block a node with
+// this delay processes, in runs where neither the samples read nor the
+// samples written cross the end of the ring. A run is never longer than
+// the delay, so every sample it reads was written before it started
+template <typename Run>
+void forEachRun(PowerOfTwoDelayLine& line, int delay, int numSamples, Run&& run) {
+  for (int start = 0; start < numSamples;) {
+    auto length = std::min(numSamples - start, delay);
+    auto reads = line.getReadSpans(delay - length, length);
+    auto writes = line.getWriteSpans(length);
+
+    for (int done = 0; done < length;) {
+      auto inFirstRead = done < reads.first.size;
+      auto inFirstWrite = done < writes.first.size;
+
+      auto* delayed = inFirstRead ? reads.first.data + done
+                                  : reads.second.data + (done - reads.first.size);
+      auto* written = inFirstWrite ? writes.first.data + done
+                                   : writes.second.data + (done - writes.first.size);
+
+      auto runLength = std::min(inFirstRead ? reads.first.size - done : length - done,
+                                inFirstWrite ? writes.first.size - done : length - done);
+
+      run(delayed, written, start + done, runLength);
+      done += runLength;
+    }
+
+    line.advance(length);
+    start += length;
+  }
+}
+}
+
+template <bool Ramp>
+void TopologyEngine::runSteps(Plan& plan, float* const* output, int startSample,
+                              int numSamples) noexcept {
+  for (int channel = 0; channel < plan.numChannels; ++channel) {
+    auto c = static_cast<size_t>(channel);
+
+    // Slot 0 is the output, the rest are the plan's scratch runs
+    auto getSlot = [&plan, output, channel, startSample](int slot) {
+      if (slot == 0)
+        return output[channel] + startSample;
+
+      return plan.slotMemory +
+             static_cast<size_t>(((slot - 1) * plan.numChannels + channel) * plan.maxBlockSize);
+    };
+
+    for (const auto& step : plan.steps) {
+      const auto* source = getSlot(step.source);
+      auto* destination = getSlot(step.destination);
+      auto gain = step.gain;
+
+      switch (step.operation) {
+        case Operation::clear:
+          std::fill(destination, destination + numSamples, 0.0f);
+          break;
+
+        case Operation::copy:
+          std::copy(source, source + numSamples, destination);
+          break;
+
+        case Operation::accumulate:
+          for (int i = 0; i < numSamples; ++i)
+            destination[i] += gain * source[i];
+          break;
+
+        case Operation::scale:
+          for (int i = 0; i < numSamples; ++i)
+            destination[i] = gain * source[i];
+          break;
+
+        case Operation::comb:
+        case Operation::combAccumulate: {
+          // y[n] = x[n] + g y[n - D]
+          auto& node = plan.nodes[static_cast<size_t>(step.node)];
+          auto feedback = node.feedback[c];
+          auto ratio = node.feedbackRatio[c];
+          auto accumulate = step.operation == Operation::combAccumulate;
+
+          forEachRun(node.lines[c], node.delays[c], numSamples,
+                     [&](const float* delayed, float* written, int offset, int length) {
+            const auto* x = source + offset;
+            auto* y = destination + offset;
+
+            if (Ramp) {
+              for (int i = 0; i < length; ++i) {
+                feedback *= ratio;
+                written[i] = x[i] + feedback * delayed[i];
+              }
+            } else {
+              for (int i = 0; i < length; ++i)
+                written[i] = x[i] + feedback * delayed[i];
+            }
+
+            if (accumulate) {
+              for (int i = 0; i < length; ++i)
+                y[i] += written[i];
+            } else {
+              std::copy(written, written + length, y);
+            }
+          });
+
+          node.feedback[c] = feedback;
+          break;
+        }
+
+        case Operation::allPass: {
+          // v[n] = x[n] + g v[n - D], y[n] = v[n - D] - g v[n]
+          auto& node = plan.nodes[static_cast<size_t>(step.node)];
+          auto allPassGain = node.description.gain;
+
+          forEachRun(node.lines[c], node.delays[c], numSamples,
+                     [&](const float* delayed, float* written, int offset, int length) {
+            const auto* x = source + offset;
+            auto* y = destination + offset;
+
+            for (int i = 0; i < length; ++i) {
+              auto state = x[i] + allPassGain * delayed[i];
+              written[i] = state;
+              y[i] = delayed[i] - allPassGain * state;
+            }
+          });
+          break;
+        }
+
+        case Operation::delay: {
+          // y[n] = g x[n - D]
+          auto& node = plan.nodes[static_cast<size_t>(step.node)];
+          auto delayGain = node.description.gain;
+
+          forEachRun(node.lines[c], node.delays[c], numSamples,
+                     [&](const float* delayed, float* written, int offset, int length) {
+            const auto* x = source + offset;
+            auto* y = destination + offset;
+
+            for (int i = 0; i < length; ++i) {
+              auto sample = x[i];
+              written[i] = sample;
+              y[i] = delayGain * delayed[i];
+            }
+          });
+          break;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include "PowerOfTwoDelayLine.h"
+#include "AlignedArena.h"
+#include "Coefficients.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * Runs a reverb network described by a ValueTree, so new networks can be
+ * shipped as data instead of code.
+ *
+ * A topology is a tree of Series and Parallel groups of Comb, AllPass and
+ * Delay nodes, e.g. the network Reverb's Schroeder engine builds:
+ *
+ *   <Topology>
+ *     <Parallel>                          gain defaults to 1 / children
+ *       <Comb delay="30.1" inverted="1"/> feedback follows the decay
+ *       <Comb delay="34.2"/>
+ *       <Comb delay="39.1" inverted="1"/>
+ *       <Comb delay="45.1"/>
+ *     </Parallel>
+ *     <AllPass delay="1.2" gain="0.5"/>
+ *     <AllPass delay="3.6" gain="0.5"/>
+ *   </Topology>
+ *
+ * The children of Topology and Series run one after the other. The children
+ * of a Parallel group each get its input, and their outputs are summed and
+ * scaled by its gain. Delays are in ms and rounded to whole samples, and the
+ * right channel's are longer by the stereo spread. A Comb can be given a
+ * fixed feedback instead of following the decay, and a Delay a gain.
+ *
+ * Loading compiles the tree into a flat list of steps, each of which runs a
+ * whole block through one node or moves a block between slots, the scratch
+ * buffers the Parallel groups sum into. Every node reads its delayed samples
+ * as contiguous runs of its ring, so the loop inside each step has no
+ * branches or index arithmetic and vectorises, and the only dispatch left
+ * is once per step per block. Every ring and slot is carved out of one
+ * AlignedArena per plan.
+ *
+ * As with ConvolutionEngine, loading happens on the calling thread, which
+ * must not be the audio thread, and the compiled plan is handed over through
+ * an atomic pointer, so process() never allocates, frees or waits on a lock.
+ */
+class TopologyEngine {
+public:
+  static constexpr int maxNumChannels = 2;
+  static constexpr int maxStereoSpread = 256;     // in samples
+  static constexpr int maxNumNodes = 64;
+  static constexpr float maxDelayTime = 1000.0f;  // in ms
+  static constexpr float feedbackRampTime = 0.02f;  // in seconds
+
+  TopologyEngine();
+  ~TopologyEngine();
+
+  // The network Reverb's Schroeder engine runs, as a topology
+  static juce::ValueTree createClassicTopology();
+
+  // Checks and compiles a topology and replaces the current one with it.
+  // Returns false, keeping the current topology, if it isn't valid. This
+  // must be called from the message thread or a background thread, never
+  // the audio thread
+  bool loadTopology(const juce::ValueTree& newTopology);
+
+  // Builds the plan for the current topology straight away. Must not be
+  // called while process() may be running
+  void prepare(float samplingRate, int maximumBlockSize, int numChannels);
+  void reset() noexcept;
+
+  // From the audio thread. A new decay is ramped to in the log domain over
+  // feedbackRampTime, in the same way as CombBank
+  void setDecay(float decay) noexcept { decayTime = decay; }
+  void setStereoSpread(int samples) noexcept;
+
+  // Writes the network's output for the input to the output, which may be
+  // the same buffer. Outputs silence until a topology has been loaded
+  void process(const juce::AudioBuffer<float>& input,
+               juce::AudioBuffer<float>& output);
+
+  // The largest magnitude of anything in the current plan's rings
+  float getPeakLevel() const noexcept;
+
+private:
+  enum class NodeType { comb, allPass, delay };
+
+  // A node as the topology describes it, independent of the sample rate
+  struct NodeDescription {
+    NodeType type = NodeType::comb;
+    float delayTime = 0.0f;  // in ms
+    float gain = 1.0f;       // fixed feedback, all-pass gain or delay gain
+    bool followsDecay = false;  // combs only, the gain is then the sign
+  };
+
+  enum class Operation {
+    clear,           // destination = 0
+    copy,            // destination = source
+    accumulate,      // destination += gain * source
+    scale,           // destination = gain * source
+    comb,            // destination = the comb of source
+    combAccumulate,  // destination += the comb of source
+    allPass,         // destination = the all-pass of source
+    delay            // destination = gain * source delayed
+  };
+
+  // One pass of a whole block. Slot 0 is the output buffer
+  struct Step {
+    Operation operation = Operation::clear;
+    int source = 0;       // slot
+    int destination = 0;  // slot
+    int node = -1;        // for the node operations
+    float gain = 1.0f;    // for accumulate and scale
+  };
+
+  // A topology compiled into steps
+  struct Program {
+    std::vector<NodeDescription> nodes;
+    std::vector<Step> steps;
+    int numSlots = 1;
+  };
+
+  // A node with its rings and feedback, for one sample rate
+  struct Node {
+    NodeDescription description;
+    std::array<PowerOfTwoDelayLine, maxNumChannels> lines;
+    std::array<int, maxNumChannels> delays {};  // in samples
+
+    // The feedback of each channel, and its ramp, for combs that follow
+    // the decay
+    std::array<float, maxNumChannels> feedback {};
+    std::array<float, maxNumChannels> feedbackRatio {};
+    std::array<float, maxNumChannels> targetFeedback {};
+    std::array<float, maxNumChannels> logFeedback {};
+    std::array<float, maxNumChannels> targetLogFeedback {};
+    std::array<float, maxNumChannels> logFeedbackStep {};
+  };
+
+  // A program ready to be processed, with all of its state
+  struct Plan {
+    std::vector<Step> steps;
+    std::vector<Node> nodes;
+    int numSlots = 1;
+    int numChannels = 0;
+    int maxBlockSize = 0;
+
+    // numSlots - 1 scratch slots of numChannels runs of maxBlockSize
+    float* slotMemory = nullptr;
+
+    // The settings the delays and feedback were last worked out from
+    CoefficientCache<1> spreadCache;
+    CoefficientCache<1> decayCache;
+    bool hasProcessed = false;  // the first decay is jumped to, not ramped
+    int rampSamplesRemaining = 0;
+
+    AlignedArena memory;
+  };
+
+  static bool compile(const juce::ValueTree& topology, Program& program);
+  std::unique_ptr<Plan> createPlan() const;
+
+  // Works the delays and feedback out again for any setting that changed
+  void updatePlan(Plan& plan) noexcept;
+  void advanceFeedbackRamp(Plan& plan, int numSamples) noexcept;
+  void finishFeedbackRamp(Plan& plan) noexcept;
+
+  template <bool Ramp>
+  void runSteps(Plan& plan, float* const* output, int startSample,
+                int numSamples) noexcept;
+
+  // Hands a plan to the audio thread and frees one it has finished with
+  void publish(std::unique_ptr<Plan> plan);
+  void releaseRetiredPlan();
+
+  // Only touched by the thread that loads topologies
+  juce::ValueTree topology;
+  float sampleRate = 0.0f;  // sample rate in Hz, 0 until prepared
+  int maxBlockSize = 0;
+  int numChannels = 0;      // channels the engine was prepared for
+
+  // Set from the audio thread and picked up by the current plan
+  float decayTime = 2.5f;  // in seconds
+  int stereoSpread = 0;    // extra delay of the right channel in samples
+
+  // The plan process() runs, owned by the audio thread
+  std::unique_ptr<Plan> current;
+
+  // A plan waiting for the audio thread to pick it up, and the one it
+  // replaced, waiting for the loading thread to free it
+  std::atomic<Plan*> pending { nullptr };
+  std::atomic<Plan*> retired { nullptr };
+
+  JUCE_DECLARE_NON_COPYABLE(TopologyEngine)
+};
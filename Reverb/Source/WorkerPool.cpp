@@ -0,0 +1,269 @@
+#include "WorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+#if JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #ifndef WIN32_LEAN_AND_MEAN
+  #define WIN32_LEAN_AND_MEAN
+ #endif
+ #include <windows.h>
+ #include <climits>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+namespace {
+// How long a worker keeps spinning after a fork before it goes to sleep
+constexpr double spinTime = 0.0002;  // in seconds
+
+// How long the join spins on a worker's task before it starts giving up its
+// core between looks
+constexpr double joinSpinTime = 0.00005;  // in seconds
+
+juce::int64 secondsToTicks(double seconds) noexcept {
+  return static_cast<juce::int64>(
+      seconds * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+}
+
+std::uint32_t getGeneration(std::uint64_t state) noexcept {
+  return static_cast<std::uint32_t>(state >> 32);
+}
+
+int getNumTasks(std::uint64_t state) noexcept {
+  return static_cast<int>((state >> 16) & 0xffff);
+}
+
+int getNextTask(std::uint64_t state) noexcept {
+  return static_cast<int>(state & 0xffff);
+}
+
+// Tells the core this is a spin loop, so it can back off for a moment
+inline void pause() noexcept {
+#if JUCE_INTEL
+  _mm_pause();
+#elif JUCE_ARM
+  __asm__ __volatile__("yield");
+#endif
+}
+
+// A counting semaphore on the OS's own. Posting is a single call that never
+// waits for a lock another thread holds, unlike signalling a
+// juce::WaitableEvent, which takes a mutex
+class Semaphore {
+public:
+  Semaphore() {
+#if JUCE_WINDOWS
+    handle = CreateSemaphore(nullptr, 0, LONG_MAX, nullptr);
+#elif JUCE_MAC || JUCE_IOS
+    handle = dispatch_semaphore_create(0);
+#else
+    sem_init(&handle, 0, 0);
+#endif
+  }
+
+  ~Semaphore() {
+#if JUCE_WINDOWS
+    CloseHandle(handle);
+#elif JUCE_MAC || JUCE_IOS
+    dispatch_release(handle);
+#else
+    sem_destroy(&handle);
+#endif
+  }
+
+  void post() noexcept {
+#if JUCE_WINDOWS
+    ReleaseSemaphore(handle, 1, nullptr);
+#elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_signal(handle);
+#else
+    sem_post(&handle);
+#endif
+  }
+
+  void wait() noexcept {
+#if JUCE_WINDOWS
+    WaitForSingleObject(handle, INFINITE);
+#elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_wait(handle, DISPATCH_TIME_FOREVER);
+#else
+    // A signal handler can cut the wait short without taking a post
+    while (sem_wait(&handle) != 0 && errno == EINTR) {
+    }
+#endif
+  }
+
+private:
+#if JUCE_WINDOWS
+  HANDLE handle;
+#elif JUCE_MAC || JUCE_IOS
+  dispatch_semaphore_t handle;
+#else
+  sem_t handle;
+#endif
+
+  JUCE_DECLARE_NON_COPYABLE(Semaphore)
+};
+}
+
+class WorkerPool::Worker : public juce::Thread {
+public:
+  explicit Worker(WorkerPool& owner) : juce::Thread("Reverb worker"), pool(owner) {}
+
+  // Wakes the worker if it has gone to sleep
+  void wake() noexcept {
+    if (sleeping.exchange(false))
+      wakeUp.post();
+  }
+
+  void stop() {
+    signalThreadShouldExit();
+    wakeUp.post();
+    stopThread(1000);
+  }
+
+  void run() override {
+    // The host only flushes denormals on its own audio thread, and the
+    // tasks decay feedback tails just like it does
+    juce::ScopedNoDenormals noDenormals;
+
+    auto seenGeneration = getGeneration(pool.state.load(std::memory_order_acquire));
+    auto spinTicks = secondsToTicks(spinTime);
+
+    while (!threadShouldExit()) {
+      auto hasNewFork = [this, &seenGeneration] {
+        return getGeneration(pool.state.load(std::memory_order_acquire)) != seenGeneration;
+      };
+
+      auto spinEnd = juce::Time::getHighResolutionTicks() + spinTicks;
+
+      while (!hasNewFork() && juce::Time::getHighResolutionTicks() < spinEnd) {
+        pause();
+      }
+
+      if (!hasNewFork()) {
+        // Say we're asleep before the last look, so a fork that lands in
+        // between is sure to see it and wake us
+        sleeping.store(true);
+
+        if (!hasNewFork()) {
+          wakeUp.wait();
+        } else if (!sleeping.exchange(false)) {
+          // The fork saw us asleep and posted. Take the post, so it doesn't
+          // cut the next sleep short
+          wakeUp.wait();
+        }
+
+        continue;
+      }
+
+      seenGeneration = getGeneration(pool.state.load(std::memory_order_acquire));
+      pool.runTasks();
+    }
+  }
+
+private:
+  WorkerPool& pool;
+  std::atomic<bool> sleeping { false };
+  Semaphore wakeUp;
+};
+
+WorkerPool::WorkerPool() {}
+
+WorkerPool::~WorkerPool() {
+  stop();
+}
+
+void WorkerPool::start(int numberOfWorkers, int blockSize, double sampleRate) {
+  jassert(numberOfWorkers >= 0 && numberOfWorkers <= maxNumWorkers);
+  stop();
+
+  auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(
+      blockSize, sampleRate);
+
+  for (int i = 0; i < numberOfWorkers; ++i) {
+    auto& worker = workers[static_cast<size_t>(i)];
+    worker = std::make_unique<Worker>(*this);
+
+    // Fall back to an ordinary thread where real-time ones aren't allowed
+    if (!worker->startRealtimeThread(options))
+      worker->startThread(juce::Thread::Priority::highest);
+  }
+
+  numWorkers = numberOfWorkers;
+}
+
+void WorkerPool::stop() {
+  for (int i = 0; i < numWorkers; ++i) {
+    workers[static_cast<size_t>(i)]->stop();
+    workers[static_cast<size_t>(i)].reset();
+  }
+
+  numWorkers = 0;
+}
+
+void WorkerPool::dispatch(int numTasks, void* context,
+                          TaskFunction function) noexcept {
+  jassert(numTasks >= 0 && numTasks <= 0xffff);
+
+  // Nothing to share out
+  if (numWorkers == 0 || numTasks <= 1) {
+    for (int i = 0; i < numTasks; ++i) {
+      function(context, i);
+    }
+
+    return;
+  }
+
+  // Every task of the last fork has finished, so nothing reads these now
+  taskContext = context;
+  taskFunction = function;
+  numTasksFinished.store(0, std::memory_order_relaxed);
+
+  auto generation = static_cast<std::uint64_t>(getGeneration(state.load()) + 1u);
+  state.store((generation << 32) | (static_cast<std::uint64_t>(numTasks) << 16));
+
+  for (int i = 0; i < numWorkers; ++i) {
+    workers[static_cast<size_t>(i)]->wake();
+  }
+
+  runTasks();
+
+  // Join: wait for the tasks the workers are still running. Every task has
+  // been claimed by now, so a task that is still going after joinSpinTime
+  // belongs to a worker the OS has most likely descheduled, often to give
+  // its core to this very thread. Spinning on would keep it from running,
+  // so from then on the core is handed back between looks
+  auto spinEnd = juce::Time::getHighResolutionTicks() + secondsToTicks(joinSpinTime);
+
+  while (numTasksFinished.load(std::memory_order_acquire) < numTasks) {
+    if (juce::Time::getHighResolutionTicks() < spinEnd)
+      pause();
+    else
+      juce::Thread::yield();
+  }
+}
+
+void WorkerPool::runTasks() noexcept {
+  auto current = state.load(std::memory_order_acquire);
+
+  while (getNextTask(current) < getNumTasks(current)) {
+    // A failed exchange reloads the state, which may be a newer fork's.
+    // Claiming from that is fine: its task was written before it
+    if (state.compare_exchange_weak(current, current + 1,
+                                    std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+      taskFunction(taskContext, getNextTask(current));
+      numTasksFinished.fetch_add(1, std::memory_order_release);
+      current = state.load(std::memory_order_acquire);
+    }
+  }
+}
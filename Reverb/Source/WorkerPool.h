@@ -0,0 +1,80 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ * A few real-time threads that the audio thread can fork a block's
+ * independent tasks out to, and join back in, inside one callback.
+ *
+ * The fork and the join are lock-free. Tasks are claimed one at a time with
+ * a compare-and-swap on a single atomic that also carries the generation
+ * and the task count, so a worker still finishing the last fork can never
+ * claim a task from the next one by mistake. The calling thread claims tasks
+ * alongside the workers, so if a worker is slow to wake up its tasks are
+ * simply done by someone else. The join only waits on the tasks a worker has
+ * actually started, and spins for no more than a few tens of microseconds
+ * before it starts yielding its core, in case the worker was descheduled to
+ * make room for the audio thread. A worker descheduled in the middle of a
+ * task can still hold up the block, since its group's output isn't ready
+ * until it finishes; with workers on real-time threads that is rare.
+ *
+ * Workers spin for a moment after each fork in case another one follows
+ * straight away, and then go to sleep on a semaphore. Waking one is a
+ * semaphore post, a single system call that never waits for a lock, and it
+ * is skipped for any worker that is still awake.
+ *
+ * Every worker flushes denormals to zero for as long as it runs, as the
+ * audio thread does during a block.
+ */
+class WorkerPool {
+public:
+  static constexpr int maxNumWorkers = 7;
+
+  WorkerPool();
+  ~WorkerPool();
+
+  // Starts numberOfWorkers real-time threads, replacing any already
+  // running. The block size and sample rate tell the OS how much work the
+  // threads will do per callback. Never call this from the audio thread
+  void start(int numberOfWorkers, int blockSize, double sampleRate);
+  void stop();
+
+  // Calls task(index) for every index below numTasks, spread across the
+  // workers and the calling thread, and returns once every call has
+  // finished. The tasks must not depend on each other
+  template <typename Task>
+  void run(int numTasks, Task& task) noexcept {
+    dispatch(numTasks, &task, [](void* context, int index) {
+      (*static_cast<Task*>(context))(index);
+    });
+  }
+
+  int getNumWorkers() const noexcept { return numWorkers; }
+
+private:
+  class Worker;
+  using TaskFunction = void (*)(void* context, int index);
+
+  void dispatch(int numTasks, void* context, TaskFunction function) noexcept;
+
+  // Claims and runs tasks of the current fork until there are none left
+  void runTasks() noexcept;
+
+  // The generation of the current fork in the top 32 bits, then its number
+  // of tasks and the next task to claim, 16 bits each
+  std::atomic<std::uint64_t> state { 0 };
+  std::atomic<int> numTasksFinished { 0 };
+
+  // The current fork's task. Only written between forks
+  void* taskContext = nullptr;
+  TaskFunction taskFunction = nullptr;
+
+  std::array<std::unique_ptr<Worker>, maxNumWorkers> workers;
+  int numWorkers = 0;
+
+  JUCE_DECLARE_NON_COPYABLE(WorkerPool)
+};
@@ -12,10 +12,14 @@
 
 #include <JuceHeader.h>
 #include "DelayLine.h"
+#include "../../shared/ParameterRamp.h"
 
 template <typename Type, size_t maxNumChannels = 2>
 class Chorus {
 public:
+    // Input quieter than this is treated as silence
+    static constexpr float silenceThreshold = 1.0e-6f; // -120 dBFS
+    
     Chorus() {
         setDelayTime(0, 0.01f);
         setDelayTime(1, 0.03f);
@@ -64,15 +68,22 @@ public:
         mix.setTargetValue(value);
     }
     
-    void prepareToPlay(double newSampleRate) {
+    // How long the output goes on for once the input stops
+    Type getTailLengthSeconds() const noexcept {
+        return maxDelayTime;
+    }
+    
+    void prepareToPlay(double newSampleRate, int maximumBlockSize) {
         // Set the sample rate
         sampleRate = static_cast<Type>(newSampleRate);
+        maxBlockSize = maximumBlockSize;
         
-        delayTimes[0].reset(sampleRate, 0.1);
-        delayTimes[1].reset(sampleRate, 0.1);
-        lfoRateHz.reset(sampleRate, 0.05);
-        lfoDepth.reset(sampleRate, 0.05);
-        mix.reset(sampleRate, 0.05);
+        // Every parameter is rendered a block at a time into its own array
+        for (auto& delayTime : delayTimes)
+            delayTime.prepare(sampleRate, 0.1, maxBlockSize);
+        lfoRateHz.prepare(sampleRate, 0.05, maxBlockSize);
+        lfoDepth.prepare(sampleRate, 0.05, maxBlockSize);
+        mix.prepare(sampleRate, 0.05, maxBlockSize);
         
         // Update the delayline size and time
         updateDelayLineSize();
@@ -81,6 +92,8 @@ public:
         // Set all phases to 0
         for (auto& phase : lfoPhase)
             phase = Type(0);
+        
+        silentSamples = 0;
     }
     
     void processBlock(juce::AudioBuffer<float>& buffer) {
@@ -88,10 +101,48 @@ public:
         const auto numChannels = std::min((int)maxNumChannels, buffer.getNumChannels());
         const auto numSamples = buffer.getNumSamples();
         
+        // The delay lines only have room for the prepared block size
+        jassert(numSamples <= maxBlockSize);
+        
+        // Once the input has been silent for longer than the delay lines
+        // are, they hold nothing but silence, so neither does the output
+        if (buffer.getMagnitude(0, numSamples) < silenceThreshold) {
+            silentSamples += (size_t) numSamples;
+            
+            if (silentSamples > delayLineSizeSamples) {
+                skipBlock(buffer, numChannels, numSamples);
+                return;
+            }
+        } else {
+            // Clear anything below the threshold left from the last block skipped
+            if (silentSamples > delayLineSizeSamples)
+                for (auto& delayLine : delayLines)
+                    delayLine.clear();
+            
+            silentSamples = 0;
+        }
+        
+        // Work out every parameter's values for the block once, so both
+        // channels read the same ramps
+        lfoRateHz.render(numSamples);
+        lfoDepth.render(numSamples);
+        mix.render(numSamples);
+        
+        const auto* rates = lfoRateHz.getValues();
+        const auto* depths = lfoDepth.getValues();
+        const auto* mixes = mix.getValues();
+        
         // Iterate through each channel
         for (auto channel = 0; channel < numChannels; ++channel) {
             auto* channelData = buffer.getWritePointer(channel);
             
+            delayTimes[channel].render(numSamples);
+            const auto* channelDelayTimes = delayTimes[channel].getValues();
+            
+            // Push the whole block to the current channels delay line at once.
+            // Sample i is then (numSamples - 1 - i) samples older than the newest
+            delayLines[channel].writeBlock(channelData, (size_t) numSamples);
+            
             // Iterate over each sample within each channel
             for (int i = 0; i < numSamples; ++i) {
                 auto inputSample = channelData[i];
@@ -100,49 +151,78 @@ public:
                 auto lfoVal = std::sin(lfoPhase[channel] * juce::MathConstants<Type>::twoPi);
                 
                 // Modulate the delay time based on the lfos value and depth
-                auto modulatedDelayTime = delayTimes[channel].getNextValue() + lfoVal * lfoDepth.getNextValue();
-                
-                // Calculate the modulated delay time in samples
-                auto modulatedDelayInSamples = modulatedDelayTime * sampleRate;
+                auto modulatedDelayTime = channelDelayTimes[i] + lfoVal * depths[i];
                 
-                // Push the raw sample value to the current channels delay line
-                delayLines[channel].push(inputSample);
+                // Calculate the modulated delay time in samples, measured from
+                // the newest sample in the delay line
+                auto modulatedDelayInSamples = modulatedDelayTime * sampleRate
+                                             + static_cast<Type>(numSamples - 1 - i);
                 
                 // read the modulated delay time sample from the delay line
                 auto delayedSample = delayLines[channel].read(modulatedDelayInSamples);
                 
                 // mix the raw sample with the delayed sample at a ratio
-                channelData[i] = inputSample * (1.0-mix.getNextValue()) + delayedSample * mix.getNextValue();
+                channelData[i] = inputSample * (Type(1) - mixes[i]) + delayedSample * mixes[i];
                 
                 // update the phase
-                lfoPhase[channel] += lfoRateHz.getNextValue() / sampleRate;
-                            if (lfoPhase[channel] >= 1.0)
-                                lfoPhase[channel] -= 1.0;
+                lfoPhase[channel] += rates[i] / sampleRate;
+                if (lfoPhase[channel] >= 1.0)
+                    lfoPhase[channel] -= 1.0;
             }
         }
+        
+        // Channels the buffer doesn't have still move their ramps on
+        for (auto channel = numChannels; channel < (int) maxNumChannels; ++channel)
+            delayTimes[channel].skip(numSamples);
     }
 private:
+    // Outputs silence and moves the lfos and parameters on as if the block
+    // had been processed
+    void skipBlock(juce::AudioBuffer<float>& buffer, int numChannels, int numSamples) {
+        buffer.clear();
+        
+        const auto phaseIncrement = lfoRateHz.getValue() * static_cast<Type>(numSamples) / sampleRate;
+        lfoRateHz.skip(numSamples);
+        lfoDepth.skip(numSamples);
+        mix.skip(numSamples);
+        
+        for (auto& delayTime : delayTimes)
+            delayTime.skip(numSamples);
+        
+        for (auto channel = 0; channel < numChannels; ++channel) {
+            lfoPhase[channel] += phaseIncrement;
+            lfoPhase[channel] -= std::floor(lfoPhase[channel]);
+        }
+    }
+    
     void updateDelayLineSize() {
-        auto delayLineSizeSamples = (size_t) std::ceil(maxDelayTime * sampleRate);
+        // Leave room for a whole block on top of the longest delay, as the
+        // block is pushed before any of it is read
+        delayLineSizeSamples = (size_t) std::ceil(maxDelayTime * sampleRate) + (size_t) maxBlockSize;
         for (auto& delayLine : delayLines)
             delayLine.resize(delayLineSizeSamples);
     }
     
     void updateDelayTime() noexcept {
         for (size_t channel = 0; channel < maxNumChannels; ++channel)
-            delayTimesSample[channel] = (size_t) juce::roundToInt (delayTimes[channel].getNextValue() * sampleRate);
+            delayTimesSample[channel] = (size_t) juce::roundToInt (delayTimes[channel].getTargetValue() * sampleRate);
     }
     
     std::array<DelayLine<Type>, maxNumChannels> delayLines;
     std::array<size_t, maxNumChannels> delayTimesSample;
-    std::array<juce::SmoothedValue<Type>, maxNumChannels> delayTimes;
+    std::array<ParameterRamp<Type>, maxNumChannels> delayTimes;
     
     Type sampleRate { Type (44.1e3) };
     Type maxDelayTime { Type (0.50) };
+    int maxBlockSize { 512 };
+    size_t delayLineSizeSamples { 0 };
+    
+    // How long the input has been silent for
+    size_t silentSamples { 0 };
     
     std::array<Type, maxNumChannels> lfoPhase {};
-    juce::SmoothedValue<Type> lfoRateHz { 0.25 };
-    juce::SmoothedValue<Type> lfoDepth { 0.005 };
-    juce::SmoothedValue<Type> mix { 0.5 };
+    ParameterRamp<Type> lfoRateHz { Type (0.25) };
+    ParameterRamp<Type> lfoDepth { Type (0.005) };
+    ParameterRamp<Type> mix { Type (0.5) };
     
 };
@@ -15,19 +15,34 @@ using namespace std;
 template <typename Type>
 class DelayLine {
 public:
+    // A contiguous run of the buffer, oldest sample first
+    template <typename SampleType>
+    struct Span {
+        SampleType* data = nullptr;
+        size_t size = 0;
+    };
+    
+    // The runs of the buffer a block of samples lives in, in time order.
+    // second is empty unless the block wraps round the end of the buffer
+    template <typename SampleType>
+    struct Spans {
+        Span<SampleType> first;
+        Span<SampleType> second;
+    };
+    
     void push(Type value) noexcept {
         // Add the new value at the oldest position
-        rawData_[leastRecentIndex_] = value;
+        rawData_[writeIndex_] = value;
         
-        // Update the least recent index in a circular motion
-        leastRecentIndex_ = leastRecentIndex_ == 0 ? size() - 1 : leastRecentIndex_ - 1;
+        // Move on to the next oldest position in a circular motion
+        writeIndex_ = writeIndex_ == size() - 1 ? 0 : writeIndex_ + 1;
     }
     
     Type get(size_t delayInSamples) const noexcept {
         // Ensure we do not exceed the size of the buffer
         jassert(delayInSamples >= 0 && delayInSamples < size());
         
-        return rawData_[(leastRecentIndex_ + 1 + delayInSamples) % size()];
+        return rawData_[indexOf(delayInSamples)];
     }
     
     // Linearly interpolation for reading values between samples
@@ -36,8 +51,8 @@ public:
         auto i1 = (i0 + 1) % size();
         auto frac = delayInSamples - static_cast<Type>(i0);
 
-        auto sample0 = rawData_[(leastRecentIndex_ + 1 + i0) % size()];
-        auto sample1 = rawData_[(leastRecentIndex_ + 1 + i1) % size()];
+        auto sample0 = rawData_[indexOf(i0 % size())];
+        auto sample1 = rawData_[indexOf(i1)];
 
         return sample0 + frac * (sample1 - sample0); // Linear interpolation
     }
@@ -45,17 +60,57 @@ public:
     void set(size_t delayInSamples, Type value) noexcept {
         // Ensure we do not exceed the size of the buffer
         jassert(delayInSamples >= 0 && delayInSamples < size());
-        rawData_[(leastRecentIndex_ + 1 + delayInSamples) % size()] = value;
+        rawData_[indexOf(delayInSamples)] = value;
+    }
+    
+    // The positions the next numSamples pushes will write to
+    Spans<Type> getWriteSpans(size_t numSamples) noexcept {
+        jassert(numSamples <= size());
+        
+        auto firstSize = std::min(numSamples, size() - writeIndex_);
+        return { { rawData_.data() + writeIndex_, firstSize },
+                 { rawData_.data(), numSamples - firstSize } };
+    }
+    
+    // The numSamples consecutive samples whose newest one is delayInSamples
+    // old, i.e. the last one is what get(delayInSamples) would return
+    Spans<const Type> getReadSpans(size_t delayInSamples, size_t numSamples) const noexcept {
+        // The oldest sample of the block must still be in the buffer
+        jassert(delayInSamples + numSamples <= size());
+        
+        auto startIndex = indexOf(delayInSamples + numSamples - 1);
+        auto firstSize = std::min(numSamples, size() - startIndex);
+        return { { rawData_.data() + startIndex, firstSize },
+                 { rawData_.data(), numSamples - firstSize } };
+    }
+    
+    // Pushes a whole block, oldest sample first
+    void writeBlock(const Type* source, size_t numSamples) noexcept {
+        auto spans = getWriteSpans(numSamples);
+        
+        std::copy(source, source + spans.first.size, spans.first.data);
+        std::copy(source + spans.first.size, source + numSamples, spans.second.data);
+        
+        writeIndex_ = (writeIndex_ + numSamples) % size();
+    }
+    
+    // Copies the samples described by getReadSpans() into destination
+    void readBlock(Type* destination, size_t numSamples, size_t delayInSamples) const noexcept {
+        auto spans = getReadSpans(delayInSamples, numSamples);
+        
+        std::copy(spans.first.data, spans.first.data + spans.first.size, destination);
+        std::copy(spans.second.data, spans.second.data + spans.second.size,
+                  destination + spans.first.size);
     }
     
     void resize(size_t newSize) {
         rawData_.resize(newSize, Type(0));
-        leastRecentIndex_ = 0;
+        writeIndex_ = 0;
     }
     
     void clear() noexcept {
         std::fill(rawData_.begin(), rawData_.end(), Type(0));
-        leastRecentIndex_ = 0;
+        writeIndex_ = 0;
     }
     
 private:
@@ -63,6 +118,11 @@ private:
         return rawData_.size();
     }
     
+    // Position of the sample pushed delayInSamples pushes ago
+    size_t indexOf(size_t delayInSamples) const noexcept {
+        return (writeIndex_ + size() - 1 - delayInSamples) % size();
+    }
+    
     vector<Type> rawData_;
-    size_t leastRecentIndex_ = 0;
+    size_t writeIndex_ = 0;
 };
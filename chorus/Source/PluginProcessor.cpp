@@ -81,7 +81,7 @@ bool ChorusAudioProcessor::isMidiEffect() const
 
 double ChorusAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return static_cast<double>(chorus.getTailLengthSeconds());
 }
 
 int ChorusAudioProcessor::getNumPrograms()
@@ -113,7 +113,7 @@ void ChorusAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
-    chorus.prepareToPlay(sampleRate);
+    chorus.prepareToPlay(sampleRate, samplesPerBlock);
 }
 
 void ChorusAudioProcessor::releaseResources()
@@ -149,6 +149,7 @@ bool ChorusAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) c
 #endif
 
 void ChorusAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) {
+    juce::ScopedNoDenormals noDenormals;
     auto numInputs = getTotalNumInputChannels();
     auto numOutputs = getTotalNumOutputChannels();
 
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/**
+ * A linearly smoothed parameter that is rendered a block at a time.
+ *
+ * render() works out the parameter's value for every sample of the next
+ * block into one 64-byte aligned array, so every channel reads the same
+ * values and the smoothing runs at the same rate however many channels
+ * there are. The loop has no branches and vectorises, unlike stepping a
+ * juce::SmoothedValue inside the per-sample loop.
+ *
+ * Once the value stops moving the array is filled with it once and then
+ * left alone, so a static parameter costs nothing per block. Callers that
+ * can use the value as a constant check isRamping() and read getValue()
+ * instead of the array.
+ *
+ * Matches juce::SmoothedValue<Type, Linear>: after setTargetValue(), the
+ * value reaches the target in a straight line over the ramp length, and
+ * the first sample rendered is already one step along.
+ */
+template <typename Type>
+class ParameterRamp {
+public:
+  static constexpr size_t alignment = 64;
+
+  explicit ParameterRamp(Type initialValue = Type(0))
+      : current(initialValue), target(initialValue) {}
+
+  // Sets how long a ramp takes and allocates room for the largest block.
+  // Jumps to the target value. Never call this from the audio thread
+  void prepare(double sampleRate, double rampLengthInSeconds,
+               int maximumBlockSize) {
+    jassert(sampleRate > 0.0 && rampLengthInSeconds >= 0.0);
+    jassert(maximumBlockSize > 0);
+
+    stepsToTarget = static_cast<int>(std::floor(rampLengthInSeconds * sampleRate));
+    maxBlockSize = maximumBlockSize;
+
+    // Over-allocate so the array can start on an aligned address
+    storage.allocate(static_cast<size_t>(maxBlockSize) + alignment / sizeof(Type), true);
+    auto address = reinterpret_cast<std::uintptr_t>(storage.get());
+    values = reinterpret_cast<Type*>((address + alignment - 1) &
+                                     ~static_cast<std::uintptr_t>(alignment - 1));
+
+    setCurrentAndTargetValue(target);
+  }
+
+  void setTargetValue(Type newValue) noexcept {
+    if (newValue == target)
+      return;
+
+    if (stepsToTarget <= 0) {
+      setCurrentAndTargetValue(newValue);
+      return;
+    }
+
+    target = newValue;
+    countdown = stepsToTarget;
+    step = (target - current) / static_cast<Type>(countdown);
+    filledWithTarget = false;
+  }
+
+  void setCurrentAndTargetValue(Type newValue) noexcept {
+    current = target = newValue;
+    countdown = 0;
+    filledWithTarget = false;
+  }
+
+  // Works out the value for each of the next numSamples samples. Call it
+  // once per block, before anything reads the values
+  void render(int numSamples) noexcept {
+    jassert(numSamples <= maxBlockSize);
+
+    ramping = countdown > 0;
+
+    if (!ramping) {
+      // The array is already full of the value unless it has just stopped
+      // moving
+      if (!filledWithTarget) {
+        std::fill(values, values + maxBlockSize, target);
+        filledWithTarget = true;
+      }
+
+      return;
+    }
+
+    auto numSteps = std::min(numSamples, countdown);
+    auto start = current;
+
+    for (int i = 0; i < numSteps; ++i) {
+      values[i] = start + step * static_cast<Type>(i + 1);
+    }
+
+    std::fill(values + numSteps, values + numSamples, target);
+
+    countdown -= numSteps;
+    current = countdown > 0 ? start + step * static_cast<Type>(numSteps) : target;
+  }
+
+  // Moves the ramp on by numSamples without rendering anything
+  void skip(int numSamples) noexcept {
+    auto numSteps = std::min(numSamples, countdown);
+    countdown -= numSteps;
+    current = countdown > 0 ? current + step * static_cast<Type>(numSteps) : target;
+  }
+
+  // Whether the values rendered by the last render() change over the block
+  bool isRamping() const noexcept { return ramping; }
+
+  // The rendered values, one per sample of the block
+  const Type* getValues() const noexcept { return values; }
+
+  // The value at the end of the last block rendered, which is the value for
+  // every sample of it when it isn't ramping
+  Type getValue() const noexcept { return current; }
+
+  Type getTargetValue() const noexcept { return target; }
+
+private:
+  Type current, target;
+  Type step = Type(0);
+  int countdown = 0;       // steps left until the target is reached
+  int stepsToTarget = 0;   // steps a whole ramp takes
+  int maxBlockSize = 0;
+
+  bool ramping = false;           // whether the last block rendered ramps
+  bool filledWithTarget = false;  // whether values holds nothing but target
+
+  juce::HeapBlock<Type> storage;
+  Type* values = nullptr;  // points into storage, aligned
+
+  JUCE_DECLARE_NON_COPYABLE(ParameterRamp)
+};